@@ -1,4 +1,5 @@
 import argparse
+import struct
 import sys
 import os
 import time
@@ -46,46 +47,170 @@ class ExporterMONOProtocol(MONOProtocol):
         """
         return None
 
-def main():
-    parser = argparse.ArgumentParser(description="Bridge script to generate LAWO/ALFA bus display payloads.")
-    
-    parser.add_argument("--text", required=True, help="The string to render.")
-    parser.add_argument("--font", required=True, help="Path to the .FXX font file.")
-    parser.add_argument("--width", type=int, required=True, help="Display width.")
-    parser.add_argument("--height", type=int, required=True, help="Display height.")
-    parser.add_argument("--type", choices=['led', 'flipdot'], required=True, help="Display type to determine protocol logic.")
-    parser.add_argument("--out", required=True, help="The destination path for the .bin file.")
+# Sign bitmap asset (.sbm), must match firmware/src/sign_asset.h
+SIGN_ASSET_MAGIC = 0x4253544F  # "OTSB"
+SIGN_ASSET_VERSION = 1
 
-    args = parser.parse_args()
 
+def packbits(data):
+    """
+    PackBits compression: a header byte n < 128 is followed by n + 1
+    literal bytes, n > 128 by one byte repeated 257 - n times.
+    """
+    out = bytearray()
+    i = 0
+    n = len(data)
+    while i < n:
+        run = 1
+        while i + run < n and run < 128 and data[i + run] == data[i]:
+            run += 1
+        if run > 1:
+            out += bytes([257 - run, data[i]])
+            i += run
+            continue
+        # Literal bytes up to the next repeat
+        start = i
+        while i < n and i - start < 128 and not (i + 1 < n and data[i] == data[i + 1]):
+            i += 1
+        out.append(i - start - 1)
+        out += data[start:i]
+    return bytes(out)
+
+
+def image_rows(image):
+    """
+    Row-major 1 bit per pixel, MSB leftmost. Like send_image_led, any
+    non-zero pixel is on.
+    """
+    width, height = image.size
+    pixels = image.load()
+    stride = (width + 7) // 8
+    rows = bytearray(stride * height)
+    for y in range(height):
+        for x in range(width):
+            if pixels[x, y] > 0:
+                rows[y * stride + x // 8] |= 0x80 >> (x % 8)
+    return bytes(rows)
+
+
+def build_bitmap_asset(images):
+    """
+    images: list of (width, height, rows). Returns the .sbm file contents:
+    header, one entry per image, then the PackBits data of each image.
+    """
+    header = struct.pack('<IBBH', SIGN_ASSET_MAGIC, SIGN_ASSET_VERSION, len(images), 0)
+    offset = len(header) + 12 * len(images)
+    entries = bytearray()
+    data = bytearray()
+    for width, height, rows in images:
+        packed = packbits(rows)
+        entries += struct.pack('<HHII', width, height, offset + len(data), len(packed))
+        data += packed
+    return header + bytes(entries) + bytes(data)
+
+
+def render_text(text, font_path, height):
+    """
+    Render `text` on its own, as wide as it is (mode 'L', 255 = on).
+    """
     # --- 1. Load Font & 2. Render Text ---
-    if args.font.lower().endswith('.ttf'):
+    if font_path.lower().endswith('.ttf'):
         # Mock Path: Use standard Pillow font rendering
         from PIL import ImageFont, ImageDraw
         # Load a system font (e.g., Arial) at the target height
-        font = ImageFont.truetype(args.font, args.height)
-        
+        font = ImageFont.truetype(font_path, height)
+
         # Create a temporary image to render text
-        text_width = font.getlength(args.text)
-        text_img = Image.new('L', (int(text_width), args.height), 0)
+        text_width = font.getlength(text)
+        text_img = Image.new('L', (int(text_width), height), 0)
         draw = ImageDraw.Draw(text_img)
-        draw.text((0, 0), args.text, font=font, fill=255)
+        draw.text((0, 0), text, font=font, fill=255)
     else:
         # Production Path: Use LAWO parser
         font = LawoFont()
-        font.read_file(args.font)
-        text_img = font.render_text(args.text)
+        font.read_file(font_path)
+        text_img = font.render_text(text)
+    return text_img
 
+
+def render_canvas(text_img, width, height):
+    """
+    Paste the rendered text left aligned and vertically centred on a
+    width x height canvas; whatever does not fit is cut off.
+    """
     # --- 3. Composite onto Canvas ---
     # Create a canvas of the target display size
-    final_img = Image.new('L', (args.width, args.height), 0)
-    
+    final_img = Image.new('L', (width, height), 0)
+
     # Position text: Centered vertically, Left aligned (x=0)
-    # Note: If text is wider than display, it will be cropped by paste or extend beyond.
-    # Standard PIL paste behavior: image is pasted at (0, y_offset).
     if text_img:
-        y_offset = (args.height - text_img.height) // 2
+        y_offset = (height - text_img.height) // 2
         final_img.paste(text_img, (0, int(y_offset)))
+    return final_img
+
+
+def parse_size(value):
+    try:
+        width, height = (int(v) for v in value.lower().split('x'))
+    except ValueError:
+        raise argparse.ArgumentTypeError(f"expected WIDTHxHEIGHT, got '{value}'")
+    return width, height
+
+
+def write_output(path, data):
+    try:
+        # Ensure directory exists
+        out_dir = os.path.dirname(os.path.abspath(path))
+        if out_dir and not os.path.exists(out_dir):
+            os.makedirs(out_dir)
+
+        with open(path, 'wb') as f:
+            f.write(data)
+    except Exception as e:
+        print(f"Error writing to output file: {e}")
+        sys.exit(1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Bridge script to generate LAWO/ALFA bus display payloads.")
+    
+    parser.add_argument("--text", required=True, help="The string to render.")
+    parser.add_argument("--font", required=True, help="Path to the .FXX font file.")
+    parser.add_argument("--width", type=int, help="Display width.")
+    parser.add_argument("--height", type=int, help="Display height.")
+    parser.add_argument("--size", type=parse_size, action='append', default=[],
+                        help="Sign geometry as WIDTHxHEIGHT; repeat for every size a bitmap asset should hold.")
+    parser.add_argument("--type", choices=['led', 'flipdot', 'bitmap'], required=True,
+                        help="Display type to determine protocol logic, or 'bitmap' for a protocol-neutral .sbm asset.")
+    parser.add_argument("--out", required=True, help="The destination path for the .bin or .sbm file.")
+
+    args = parser.parse_args()
+
+    sizes = list(args.size)
+    if args.width is not None and args.height is not None:
+        sizes.insert(0, (args.width, args.height))
+    if not sizes:
+        parser.error("--width and --height, or --size, are required")
+
+    # Bitmap assets hold the image for every size and no protocol at all;
+    # the firmware frames them for the sign it sends to
+    if args.type == 'bitmap':
+        images = []
+        for width, height in sizes:
+            text_img = render_text(args.text, args.font, height)
+            # Text too wide for the sign is stored whole, as a strip of the
+            # sign's height that the firmware scrolls or pages through
+            if text_img and text_img.width > width:
+                width = text_img.width
+            if any(w == width and h == height for w, h, _ in images):
+                continue
+            image = render_canvas(text_img, width, height)
+            images.append((width, height, image_rows(image)))
+        write_output(args.out, build_bitmap_asset(images))
+        return
+
+    width, height = sizes[0]
+    final_img = render_canvas(render_text(args.text, args.font, height), width, height)
 
     # --- 4. Initialize Protocol ---
     # Use our capturing subclass
@@ -93,7 +218,7 @@ def main():
     
     # Set virtual display attributes (address 1 is arbitrary but required for internal checks)
     address = 1
-    protocol.set_display_attributes(address, {'width': args.width, 'height': args.height})
+    protocol.set_display_attributes(address, {'width': width, 'height': height})
 
     # --- 5. Generate Payload ---
     try:
@@ -112,19 +237,7 @@ def main():
         sys.exit(1)
 
     # --- 6. Write Output ---
-    try:
-        # Ensure directory exists
-        out_dir = os.path.dirname(os.path.abspath(args.out))
-        if out_dir and not os.path.exists(out_dir):
-            os.makedirs(out_dir)
-
-        with open(args.out, 'wb') as f:
-            f.write(protocol.packet_data)
-        
-        # print(f"Success: Wrote {len(protocol.packet_data)} bytes to {args.out}")
-    except Exception as e:
-        print(f"Error writing to output file: {e}")
-        sys.exit(1)
+    write_output(args.out, protocol.packet_data)
 
 if __name__ == "__main__":
     main()
@@ -4,6 +4,143 @@ import { execFileSync } from 'child_process';
 import { app } from 'electron';
 import { Route } from './database';
 
+// Sign geometries every bitmap asset carries; the firmware picks the one
+// matching its configured sign and frames it as LED or flipdot MONO
+const SIGN_SIZES = ['112x16'];
+
+// Bitmap assets replace the old pre-framed .bin files, which were bound to
+// one sign type and address
+function assetFileName(route: Route): string {
+  const base = route.alfaSignBinFile || `${route.id}.bin`;
+  return `${base.replace(/\.[^.]*$/, '')}.sbm`;
+}
+
+// Must match firmware/src/route_catalog.h
+const CATALOG_MAGIC = 0x4352544f; // "OTRC"
+const CATALOG_VERSION = 2;
+const CATALOG_HEADER_SIZE = 32;
+const CATALOG_RECORD_SIZE = 11;
+
+// Same framing as IbisTelegram in firmware: content, CR, then the XOR of
+// 0x7F and every byte including the CR
+function ibisFrame(content: string): Buffer {
+  const bytes = Buffer.from(content, 'ascii');
+  let parity = 0x7f ^ 0x0d;
+  for (const b of bytes) parity ^= b;
+  return Buffer.concat([bytes, Buffer.from([0x0d, parity])]);
+}
+
+// Line and destination telegrams, sent unchanged by the firmware on Apply
+function encodeIbisFrames(route: Route): Buffer {
+  const pad = (n: number) => String(n & 0xffff).padStart(3, '0');
+  return Buffer.concat([
+    ibisFrame(`l${pad(route.ibisLineCmd)}`),
+    ibisFrame(`z${pad(route.ibisDestinationCmd)}`),
+  ]);
+}
+
+// FNV-1a over the UTF-8 bytes of the id, same as catalogHash() in firmware
+function catalogHash(bytes: Buffer): number {
+  let hash = 0x811c9dc5;
+  for (const b of bytes) {
+    hash ^= b;
+    hash = Math.imul(hash, 0x01000193) >>> 0;
+  }
+  return hash >>> 0;
+}
+
+function encodeRecord(route: Route, binFileName: string): Buffer {
+  const id = Buffer.from(route.id, 'utf8');
+  const name = Buffer.from(route.name, 'utf8');
+  const text = Buffer.from(route.alfaSignText, 'utf8');
+  const binFile = Buffer.from(binFileName, 'utf8');
+  const ibis = encodeIbisFrames(route);
+
+  if (id.length > 255 || name.length > 255 || binFile.length > 255) {
+    throw new Error(`Route ${route.id}: id, name or bin file name too long`);
+  }
+  if (text.length > 65535) {
+    throw new Error(`Route ${route.id}: sign text too long`);
+  }
+
+  const header = Buffer.alloc(CATALOG_RECORD_SIZE);
+  header.writeUInt16LE(route.ibisLineCmd & 0xffff, 0);
+  header.writeUInt16LE(route.ibisDestinationCmd & 0xffff, 2);
+  header.writeUInt8(route.type === 'tram' ? 1 : 0, 4);
+  header.writeUInt8(id.length, 5);
+  header.writeUInt8(name.length, 6);
+  header.writeUInt8(binFile.length, 7);
+  header.writeUInt16LE(text.length, 8);
+  header.writeUInt8(ibis.length, 10);
+
+  const nul = Buffer.alloc(1);
+  return Buffer.concat([
+    header,
+    id,
+    nul,
+    name,
+    nul,
+    text,
+    nul,
+    binFile,
+    nul,
+    ibis,
+  ]);
+}
+
+/**
+ * Builds catalog.bin: fixed header, offset table, id lookup table sorted by
+ * hash, then packed records (buses first, trams after).
+ */
+function buildCatalog(routes: Route[]): Buffer {
+  const ordered = [
+    ...routes.filter((r) => r.type === 'bus'),
+    ...routes.filter((r) => r.type === 'tram'),
+  ];
+  const busCount = ordered.filter((r) => r.type === 'bus').length;
+  const records = ordered.map((route) =>
+    encodeRecord(route, assetFileName(route)),
+  );
+
+  const count = records.length;
+  const offsetTable = CATALOG_HEADER_SIZE;
+  const lookupTable = offsetTable + (count + 1) * 4;
+  const recordsStart = lookupTable + count * 8;
+
+  const offsets = Buffer.alloc((count + 1) * 4);
+  let offset = recordsStart;
+  records.forEach((record, i) => {
+    offsets.writeUInt32LE(offset, i * 4);
+    offset += record.length;
+  });
+  offsets.writeUInt32LE(offset, count * 4);
+  const fileSize = offset;
+
+  const lookup = Buffer.alloc(count * 8);
+  ordered
+    .map((route, index) => ({
+      hash: catalogHash(Buffer.from(route.id, 'utf8')),
+      index,
+    }))
+    .sort((a, b) => a.hash - b.hash || a.index - b.index)
+    .forEach((entry, i) => {
+      lookup.writeUInt32LE(entry.hash, i * 8);
+      lookup.writeUInt32LE(entry.index, i * 8 + 4);
+    });
+
+  const header = Buffer.alloc(CATALOG_HEADER_SIZE);
+  header.writeUInt32LE(CATALOG_MAGIC, 0);
+  header.writeUInt16LE(CATALOG_VERSION, 4);
+  header.writeUInt16LE(CATALOG_HEADER_SIZE, 6);
+  header.writeUInt32LE(count, 8);
+  header.writeUInt32LE(busCount, 12);
+  header.writeUInt32LE(offsetTable, 16);
+  header.writeUInt32LE(lookupTable, 20);
+  header.writeUInt32LE(fileSize, 24);
+
+  return Buffer.concat([header, offsets, lookup, ...records]);
+}
+
 export function generateEsp32Files(routes: Route[], outputDir: string): void {
   const busesDir = path.join(outputDir, 'data', 'buses');
   const tramsDir = path.join(outputDir, 'data', 'trams');
@@ -38,9 +175,15 @@ export function generateEsp32Files(routes: Route[], outputDir: string): void {
     '../alfa-bus-protocol/exporter_bridge.py',
   );
 
+  type IndexEntry = {
+    name: string;
+    file: string;
+    ibisLineCmd: number;
+    ibisDestinationCmd: number;
+  };
   const indexData = {
-    buses: [] as { name: string; file: string }[],
-    trams: [] as { name: string; file: string }[],
+    buses: [] as IndexEntry[],
+    trams: [] as IndexEntry[],
   };
 
   routes.forEach((route) => {
@@ -49,37 +192,40 @@ export function generateEsp32Files(routes: Route[], outputDir: string): void {
     const fileName = `${route.id}.json`;
     const filePath = path.join(targetDir, fileName);
 
+    // Line and destination let the firmware pick a route from IBIS telegrams
+    const entry = {
+      name: route.name,
+      file: route.id,
+      ibisLineCmd: route.ibisLineCmd,
+      ibisDestinationCmd: route.ibisDestinationCmd,
+    };
     if (route.type === 'bus') {
-      indexData.buses.push({ name: route.name, file: route.id });
+      indexData.buses.push(entry);
     } else if (route.type === 'tram') {
-      indexData.trams.push({ name: route.name, file: route.id });
+      indexData.trams.push(entry);
     }
 
-    // Generate binary file using the python bridge
-    const binFileName = route.alfaSignBinFile || `${route.id}.bin`;
+    // Generate the bitmap asset using the python bridge
+    const binFileName = assetFileName(route);
     const binFilePath = path.join(targetDir, binFileName);
 
     try {
-      // Default to Arial.ttf (system font) and standard dimensions for now
-      // These could be parameterized in the DB if needed later
+      // Default to Arial.ttf (system font) for now
       execFileSync(pythonPath, [
         scriptPath,
         '--text',
-        `"${route.alfaSignText}"`,
+        route.alfaSignText,
         '--font',
         fontPath,
-        '--width',
-        '112', // Standard width
-        '--height',
-        '16', // Standard height
+        ...SIGN_SIZES.flatMap((size) => ['--size', size]),
         '--type',
-        'led',
+        'bitmap',
         '--out',
         binFilePath,
       ]);
     } catch (error) {
-      console.error(`Failed to generate binary for route ${route.id}:`, error);
-      // We continue even if binary generation fails, but log it
+      console.error(`Failed to generate bitmap for route ${route.id}:`, error);
+      // We continue even if bitmap generation fails, but log it
     }
 
     const data = {
@@ -96,4 +242,9 @@ export function generateEsp32Files(routes: Route[], outputDir: string): void {
 
   const indexJsonPath = path.join(outputDir, 'data', 'index.json');
   fs.writeFileSync(indexJsonPath, JSON.stringify(indexData, null, 2));
+
+  // Firmware prefers the binary catalog and only falls back to the JSON files
+  // above when catalog.bin is missing.
+  const catalogPath = path.join(outputDir, 'data', 'catalog.bin');
+  fs.writeFileSync(catalogPath, buildCatalog(routes));
 }
@@ -5,14 +5,56 @@
 
 // IBIS Bus (Serial 2)
 #define PIN_IBIS_TX 0
+// Set PIN_IBIS_RX to a pin to listen to the vehicle's IBIS master and
+// select the route from its line/destination telegrams. Nothing is then
+// sent on the IBIS bus, the master keeps driving its signs.
 #define PIN_IBIS_RX -1
 
+// Character set of the IBIS signs: IBIS_CODEPAGE_DIN66003 (Latin, Cyrillic
+// transliterated) or IBIS_CODEPAGE_KOI7 (Cyrillic capitals)
+#define IBIS_CODE_PAGE IBIS_CODEPAGE_DIN66003
+#define IBIS_FALLBACK_CHAR '?'
+
 // Alfa Bus (Serial 1)
 #define PIN_ALFA_TX 17
+// Set PIN_ALFA_RX to a pin to read sign replies: queries are confirmed and
+// retried, and the displays on the bus are found at boot
 #define PIN_ALFA_RX -1
 
 // Config for Alfa Binary Transmission
 #define ALFA_BAUD_RATE 19200
 #define ALFA_SERIAL_CONFIG SERIAL_8N1
 
+// The MONO sign on the Alfa bus. Routes exported as bitmap assets (.sbm)
+// are framed for it when sent: MONO_SIGN_FLIPDOT or MONO_SIGN_LED (up to
+// 255 bitmap bytes, e.g. 112x16). The asset must contain an image of
+// exactly this size.
+#define ALFA_SIGN_TYPE MONO_SIGN_FLIPDOT
+#define ALFA_SIGN_ADDRESS 1
+#define ALFA_SIGN_WIDTH 112
+#define ALFA_SIGN_HEIGHT 16
+#define ALFA_SIGN_COLUMN_OFFSET 0
+
+// Several MONO panels used as one canvas instead of the single sign above,
+// e.g. three 26x48 LED panels side by side. Per panel: {type, address,
+// width, height, x, y, flipdot column offset}. The canvas is the bounding
+// box of all panels, and bitmap assets must be exported at that size.
+/*
+#define ALFA_PANELS                       \
+  {{MONO_SIGN_LED, 1, 26, 48, 0, 0, 0},   \
+   {MONO_SIGN_LED, 2, 26, 48, 26, 0, 0},  \
+   {MONO_SIGN_LED, 3, 26, 48, 52, 0, 0}}
+*/
+
+// Render the route's alfaSignText with a LAWO font from LittleFS instead
+// of sending its exported file. On flipdot signs only the dots that
+// change are flipped.
+// #define ALFA_FONT_PATH "/fonts/LAWO16.F16"
+
+// Text wider than the sign: MARQUEE_SCROLL moves it across, MARQUEE_PAGE
+// shows it a page at a time, MARQUEE_CROP cuts it off. Exported strips
+// scroll unless cropped. Step sizes and times are the MARQUEE_* build
+// flags in sign_marquee.h.
+#define ALFA_LONG_TEXT MARQUEE_SCROLL
+
 #endif  // CONFIG_EXAMPLE_H
@@ -0,0 +1,59 @@
+#ifndef IBIS_CHARSET_H
+#define IBIS_CHARSET_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "utf8.h"
+
+/**
+ * @brief 7-bit character sets understood by IBIS signs
+ */
+enum IbisCodePage : uint8_t {
+  // DIN 66003: ASCII with umlauts on []{}|\~, Cyrillic is transliterated
+  IBIS_CODEPAGE_DIN66003 = 0,
+  // KOI-7 N2: upper case Latin and upper case Cyrillic on 0x60-0x7E
+  IBIS_CODEPAGE_KOI7 = 1,
+};
+
+// Longest replacement for a single code point ("Shch")
+#define IBIS_CHAR_MAX 4
+
+#define IBIS_DEFAULT_FALLBACK '?'
+
+/**
+ * @brief Map a Unicode code point to the sign's character set
+ * @param out Receives up to IBIS_CHAR_MAX characters
+ * @return Number of characters written (0 for letters that are dropped,
+ *         like the soft sign in transliteration), -1 if not mappable
+ */
+int ibisMapCodepoint(IbisCodePage page, uint32_t cp, char *out);
+
+/**
+ * @brief Transcode UTF-8 text in a single pass
+ * @param sink Called with every output character
+ */
+template <typename Sink>
+void ibisTranscode(const char *text,
+                   IbisCodePage page,
+                   char fallback,
+                   Sink &&sink) {
+  const uint8_t *p = (const uint8_t *)text;
+  char out[IBIS_CHAR_MAX];
+  while (*p) {
+    // ASCII maps to itself, except KOI-7's lower case range
+    if (*p < 0x60 || (*p < 0x80 && page == IBIS_CODEPAGE_DIN66003)) {
+      sink((char)*p++);
+      continue;
+    }
+    uint32_t cp;
+    p += utf8Decode(p, cp);
+    int n = ibisMapCodepoint(page, cp, out);
+    if (n < 0) {
+      sink(fallback);
+      continue;
+    }
+    for (int i = 0; i < n; i++) sink(out[i]);
+  }
+}
+
+#endif  // IBIS_CHARSET_H
@@ -0,0 +1,101 @@
+#ifndef IBIS_DS021T_H
+#define IBIS_DS021T_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "ibis_charset.h"
+#include "ibis_telegram.h"
+#include "sign_transport.h"
+
+// DS021t text is sent in blocks of 16 characters
+#define IBIS_DS021T_BLOCK 16
+// The block count is sent as two VDV hex digits
+#define IBIS_DS021T_MAX_BLOCKS 255
+
+/**
+ * @brief Streaming DS021t (multi-block text) encoder
+ *
+ * Frame: "aA" address blocks "A0" text [\n] \n\n padding CR parity, where
+ * `blocks` is the exact number of 16-byte blocks of the padded text. Text
+ * is transcoded into a single block buffer that is handed to the transport
+ * (see sign_transport.h) as soon as it is full, so no buffer holds the
+ * whole telegram.
+ */
+template <typename Transport>
+class IbisDs021tEncoder {
+public:
+  IbisDs021tEncoder(Transport &transport,
+                    IbisCodePage page,
+                    char fallback = IBIS_DEFAULT_FALLBACK)
+      : _transport(transport), _page(page), _fallback(fallback) {}
+
+  /**
+   * @return Bytes written to the transport including CR and parity, 0 if
+   *         the text needs more than IBIS_DS021T_MAX_BLOCKS blocks
+   */
+  size_t encode(const char *address, const char *text) {
+    // A text with a line break (not leading) gets a blank line before the
+    // terminating double newline, as the signs expect
+    const char *newline = strchr(text, '\n');
+    bool extraNewline = newline && newline != text;
+
+    size_t textLen = 0;
+    ibisTranscode(text, _page, _fallback, [&textLen](char) { textLen++; });
+    textLen += extraNewline ? 3 : 2;
+    size_t blocks = (textLen + IBIS_DS021T_BLOCK - 1) / IBIS_DS021T_BLOCK;
+    if (blocks > IBIS_DS021T_MAX_BLOCKS) return 0;
+
+    _fill = 0;
+    _total = 0;
+    _parity = IBIS_PARITY_SEED;
+
+    put('a');
+    put('A');
+    while (*address) put(*address++);
+    if (blocks >> 4) put('0' + (blocks >> 4));
+    put('0' + (blocks & 0x0F));
+    put('A');
+    put('0');
+    flushBlock();  // text blocks start on a block boundary
+
+    ibisTranscode(text, _page, _fallback, [this](char c) { put(c); });
+    if (extraNewline) put('\n');
+    put('\n');
+    put('\n');
+    while (_fill > 0) put(' ');
+
+    // CR and parity; parity covers everything written before
+    _block[0] = 0x0D;
+    _block[1] = _parity;
+    _fill = 2;
+    flushBlock();
+    _transport.flush();
+    return _total;
+  }
+
+private:
+  Transport &_transport;
+  IbisCodePage _page;
+  char _fallback;
+
+  uint8_t _block[IBIS_DS021T_BLOCK];
+  size_t _fill = 0;
+  size_t _total = 0;
+  uint8_t _parity = IBIS_PARITY_SEED;
+
+  void put(char c) {
+    _block[_fill++] = (uint8_t)c;
+    _parity ^= (uint8_t)c;
+    if (_fill == IBIS_DS021T_BLOCK) flushBlock();
+  }
+
+  void flushBlock() {
+    if (_fill == 0) return;
+    _transport.write(ByteSpan{_block, _fill});
+    _total += _fill;
+    _fill = 0;
+  }
+};
+
+#endif  // IBIS_DS021T_H
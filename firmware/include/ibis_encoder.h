@@ -0,0 +1,119 @@
+#ifndef IBIS_ENCODER_H
+#define IBIS_ENCODER_H
+
+#include "ibis_charset.h"
+#include "ibis_ds021t.h"
+#include "ibis_telegram.h"
+#include "sign_transport.h"
+
+// Longest raw frame accepted by IbisEncoder::raw()
+#define IBIS_RAW_MAX 512
+
+// Longest text telegram content, prefix included, after transcoding
+#define IBIS_TEXT_MAX 128
+
+/**
+ * @brief Encodes IBIS telegrams and writes them to a transport
+ *
+ * Every method writes one complete frame (content, CR, parity) and then
+ * flushes the transport. Nothing is written if the telegram does not fit.
+ */
+template <typename Transport>
+class IbisEncoder {
+  static_assert(IsSignTransport<Transport>::value,
+                "Transport needs write(ByteSpan), flush() and now()");
+
+public:
+  explicit IbisEncoder(Transport &transport,
+                       IbisCodePage page = IBIS_CODEPAGE_DIN66003,
+                       char fallback = IBIS_DEFAULT_FALLBACK)
+      : _transport(transport), _page(page), _fallback(fallback) {}
+
+  // Each returns the frame size in bytes, 0 if nothing was written
+
+  size_t line(uint16_t line) {
+    IbisTelegram<> telegram("l", PARITY_LINE);
+    telegram.putNumber(line, 3);
+    return send(telegram);
+  }
+
+  size_t destination(uint16_t dest) {
+    IbisTelegram<> telegram("z", PARITY_DESTINATION);
+    telegram.putNumber(dest, 3);
+    return send(telegram);
+  }
+
+  size_t cycle(uint8_t cycle) {
+    IbisTelegram<> telegram("xC", PARITY_CYCLE);
+    telegram.putNumber(cycle, 1);
+    return send(telegram);
+  }
+
+  size_t time(const char *hhmm) {
+    IbisTelegram<> telegram("u", PARITY_TIME);
+    telegram.putText(hhmm);
+    return send(telegram);
+  }
+
+  size_t text(const char *text) {
+    IbisTelegram<IBIS_TEXT_MAX> telegram("v", PARITY_TEXT);
+    telegram.putUtf8(text, _page, _fallback);
+    return send(telegram);
+  }
+
+  size_t complexText(const char *text) {
+    IbisTelegram<IBIS_TEXT_MAX> telegram("zM ", PARITY_COMPLEX_TEXT);
+    telegram.putUtf8(text, _page, _fallback);
+    return send(telegram);
+  }
+
+  size_t symbol(const char *number) {
+    IbisTelegram<> telegram("lE0", PARITY_SYMBOL);
+    telegram.putText(number);
+    return send(telegram);
+  }
+
+  size_t ds021t(const char *address, const char *text) {
+    IbisDs021tEncoder<Transport> encoder(_transport, _page, _fallback);
+    return encoder.encode(address, text);
+  }
+
+  /**
+   * @brief A frame that already carries CR and parity, written unchanged
+   */
+  size_t raw(const uint8_t *frame, size_t len) {
+    // The shortest frame is an empty telegram: CR and parity
+    if (len < 2 || len > IBIS_RAW_MAX) return 0;
+    _transport.write(ByteSpan{frame, len});
+    _transport.flush();
+    return len;
+  }
+
+private:
+  // Parity of the constant telegram prefixes, folded in at compile time
+  static constexpr uint8_t PARITY_LINE = ibisParity("l");
+  static constexpr uint8_t PARITY_DESTINATION = ibisParity("z");
+  static constexpr uint8_t PARITY_CYCLE = ibisParity("xC");
+  static constexpr uint8_t PARITY_TIME = ibisParity("u");
+  static constexpr uint8_t PARITY_TEXT = ibisParity("v");
+  // Parity of "zM " is 0x7A ^ 0x4D ^ 0x20 = 0x17, 0x72 ^ 0x17 = 0x65
+  static constexpr uint8_t PARITY_COMPLEX_TEXT = ibisParity("zM ");
+  static constexpr uint8_t PARITY_SYMBOL = ibisParity("lE0");
+
+  static_assert(PARITY_COMPLEX_TEXT == 0x65, "IBIS parity seed mismatch");
+
+  Transport &_transport;
+  IbisCodePage _page;
+  char _fallback;
+
+  template <size_t N>
+  size_t send(IbisTelegram<N> &telegram) {
+    if (telegram.overflowed()) return 0;
+    telegram.finish();
+    _transport.write(ByteSpan{telegram.data(), telegram.frameLength()});
+    _transport.flush();
+    return telegram.frameLength();
+  }
+};
+
+#endif  // IBIS_ENCODER_H
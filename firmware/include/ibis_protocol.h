@@ -2,102 +2,186 @@
 #define IBIS_PROTOCOL_H
 
 #include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "ibis_encoder.h"
+#include "uart_transport.h"
+
+// Silence between the end of one telegram and the start of the next. The
+// old fixed 200 ms delay included ~55 ms of airtime for "l001", so 150 ms
+// keeps the same pace for short telegrams.
+#ifndef IBIS_TX_GAP_MS
+#define IBIS_TX_GAP_MS 150
+#endif
+
+#ifndef IBIS_TX_QUEUE_LENGTH
+#define IBIS_TX_QUEUE_LENGTH 16
+#endif
+
+// Telegrams are queued in chunks of this many bytes
+#define IBIS_TX_CHUNK 64
+
+// Airtime of one character at 1200 baud 7E2 (start + 7 + parity + 2 stop)
+#define IBIS_CHAR_TIME_US (11 * 1000000UL / 1200)
+
+struct IbisTxStats {
+  uint32_t sent;           // telegrams fully transmitted
+  uint32_t timeouts;       // telegrams whose end never left the UART
+  uint32_t queueDepth;     // chunks waiting to be sent
+  uint32_t lastLatencyMs;  // from the set* call to the last stop bit
+  uint32_t maxLatencyMs;
+};
 
 class IbisProtocol {
 public:
   /**
    * @brief Initialize IBIS Protocol
-   * @param serial The HardwareSerial port to use (e.g. Serial2)
+   * @param uart The UART transport of the IBIS bus
+   */
+  IbisProtocol(UartTransport &uart);
+
+  /**
+   * @brief configure the UART (1200 baud, 7E2) and start the TX task
+   * @param rxPin,txPin -1 leaves the pin unassigned
+   */
+  void begin(int8_t rxPin, int8_t txPin);
+
+  /**
+   * @brief Set the silence enforced after each telegram has left the UART
+   */
+  void setInterTelegramGap(uint16_t ms);
+
+  /**
+   * @brief Block until every queued telegram has been transmitted
+   * @return false on timeout
+   */
+  bool waitIdle(uint32_t timeoutMs);
+
+  IbisTxStats stats();
+
+  /**
+   * @brief Character set of the signs on this bus, used for all text
+   * @param fallback Sent for characters the code page cannot show
    */
-  IbisProtocol(HardwareSerial &serial);
+  void setCodePage(IbisCodePage page, char fallback = IBIS_DEFAULT_FALLBACK);
 
   /**
-   * @brief configure serial port (1200 baud, 7E2)
+   * @brief Send a telegram that is already framed (content, CR, parity)
+   *
+   * The bytes go out unchanged, e.g. telegrams precompiled in the catalog.
+   * @return Bytes queued, 0 if the frame is empty or too long
    */
-  void begin();
+  size_t sendRaw(const uint8_t *frame, size_t len);
 
   /**
    * @brief Set Line Number (Command 'l')
    * @param line Line number (up to 3 digits usually)
+   * @return Bytes queued including CR and parity, 0 if dropped
    */
-  void setLine(uint16_t line);
+  size_t setLine(uint16_t line);
 
   /**
    * @brief Set Destination Number (Command 'z')
    * @param dest Destination number (up to 3 digits usually)
+   * @return Bytes queued including CR and parity, 0 if dropped
    */
-  void setDestination(uint16_t dest);
+  size_t setDestination(uint16_t dest);
 
   /**
    * @brief Set Cycle Number (Command 'xC')
    * @param cycle Cycle number (0-15 usually)
+   * @return Bytes queued including CR and parity, 0 if dropped
    */
-  void setCycle(uint8_t cycle);
+  size_t setCycle(uint8_t cycle);
 
   /**
    * @brief Set Time (Command 'u')
    * @param hhmm Time string usually in "HHmm" format
+   * @return Bytes queued including CR and parity, 0 if dropped
    */
-  void setTime(String hhmm);
+  size_t setTime(const char *hhmm);
 
   /**
    * @brief Set Text (Command 'v')
-   * @param text Text to display
+   * @param text UTF-8 text to display
+   * @return Bytes queued including CR and parity, 0 if dropped
    */
-  void setText(String text);
+  size_t setText(const char *text);
 
   /**
    * @brief Set Complex/Menu Text (Command 'zM')
-   * @param text Text to display
+   * @param text UTF-8 text to display
+   * @return Bytes queued including CR and parity, 0 if dropped
    */
-  void setComplexText(String text);
+  size_t setComplexText(const char *text);
 
   /**
    * @brief Set Announcer/Symbol (Command 'lE')
    * @param number Symbol number
+   * @return Bytes queued including CR and parity, 0 if dropped
    */
-  void setSymbol(String number);
+  size_t setSymbol(const char *number);
 
   /**
    * @brief Set DS021t Multi-block text
    * @param address Address string
-   * @param text Full text content (handles blocking automatically)
-   */
-  void setDS021t(String address, String text);
-
-  /**
-   * @brief Replace German umlauts with IBIS-specific mapped chars
-   * @param telegram String to process (modified in-place)
+   * @param text Full UTF-8 text content (handles blocking automatically)
+   * @return Bytes queued including CR and parity, 0 if dropped
    */
-  void processSpecialCharacters(String *telegram);
+  size_t setDS021t(const char *address, const char *text);
 
 private:
-  HardwareSerial &_serial;
-
-  /**
-   * @brief Send a raw telegram with framing and checksum
-   * @param content The telegram content (excluding CR and Parity)
-   */
-  void sendTelegram(String content);
-
-  /**
-   * @brief Calculate IBIS parity
-   * @param text The text to verify
-   * @param startChecksum Initial checksum value (default 0x72 for [7F ^ 0D])
-   * @return Calculated parity byte
-   */
-  unsigned char calculateParity(const String &text,
-                                unsigned char startChecksum = 0x72);
-
-  /**
-   * @brief Helper to format numbers with leading zeros
-   */
-  String padNumber(uint16_t num, uint8_t digits);
+  UartTransport &_uart;
+
+  struct TxChunk {
+    uint32_t queuedAt;
+    uint8_t len;
+    bool first;
+    bool last;
+    uint8_t data[IBIS_TX_CHUNK];
+  };
+
+  QueueHandle_t _txQueue = nullptr;
+  SemaphoreHandle_t _enqueueLock = nullptr;
+  SemaphoreHandle_t _pendingLock = nullptr;
+  EventGroupHandle_t _txEvents = nullptr;
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  volatile uint16_t _gapMs = IBIS_TX_GAP_MS;
+  volatile IbisCodePage _codePage = IBIS_CODEPAGE_DIN66003;
+  volatile char _fallback = IBIS_DEFAULT_FALLBACK;
+  uint32_t _pending = 0;  // telegrams queued but not yet fully sent
+  IbisTxStats _stats = {};
 
   /**
-   * @brief Helper for VDV Hex encoding (DS021t)
+   * @brief Transport (see sign_transport.h) onto the TX queue
+   *
+   * Packs one telegram into queue chunks. The enqueue lock is taken on the
+   * first write and held until flush() so chunks of different senders do
+   * not interleave; flush() marks the last chunk as the telegram's end.
    */
-  String vdvHex(byte value);
+  class TxStream {
+  public:
+    explicit TxStream(IbisProtocol &ibis) : _ibis(ibis) {}
+    ~TxStream() { flush(); }
+    size_t write(ByteSpan bytes);
+    void flush();
+    uint32_t now() { return millis(); }
+
+  private:
+    IbisProtocol &_ibis;
+    bool _open = false;
+    TxChunk _chunk;
+  };
+
+  IbisEncoder<TxStream> encoder(TxStream &stream) {
+    return IbisEncoder<TxStream>(stream, _codePage, _fallback);
+  }
+
+  size_t logDropped(size_t bytes);
+  bool waitTxDone();
+  static void txTask(void *arg);
 };
 
 #endif  // IBIS_PROTOCOL_H
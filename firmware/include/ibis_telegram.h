@@ -0,0 +1,118 @@
+#ifndef IBIS_TELEGRAM_H
+#define IBIS_TELEGRAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "ibis_charset.h"
+
+// IBIS Checksum: Inverse (0x7F) XOR with all bytes including CR (0x0D)
+// 0x7F ^ 0x0D = 0x72. So we start with 0x72 and XOR all data bytes.
+#define IBIS_PARITY_SEED 0x72
+
+/**
+ * @brief XOR parity of a string, usable at compile time for fixed prefixes
+ * @param seed Parity accumulated so far (default: empty telegram)
+ */
+constexpr uint8_t ibisParity(const char *text, uint8_t seed = IBIS_PARITY_SEED) {
+  while (*text) seed ^= (uint8_t)*text++;
+  return seed;
+}
+
+/**
+ * @brief Fixed-capacity IBIS telegram built in place, no heap allocation
+ *
+ * Content, CR and parity are written in one pass; the parity is updated as
+ * each byte is appended. Writes past `Capacity` are dropped and flagged.
+ */
+template <size_t Capacity = 64>
+class IbisTelegram {
+public:
+  IbisTelegram() = default;
+
+  /**
+   * @brief Start with a constant prefix whose parity was computed up front
+   * @param parity ibisParity(prefix), ideally a constexpr
+   */
+  template <size_t N>
+  IbisTelegram(const char (&prefix)[N], uint8_t parity) {
+    static_assert(N - 1 <= Capacity, "prefix longer than telegram");
+    memcpy(_buf, prefix, N - 1);
+    _len = N - 1;
+    _parity = parity;
+  }
+
+  void put(char c) {
+    if (_len >= Capacity) {
+      _overflow = true;
+      return;
+    }
+    _buf[_len++] = (uint8_t)c;
+    _parity ^= (uint8_t)c;
+  }
+
+  void putText(const char *text) {
+    while (*text) put(*text++);
+  }
+
+  /**
+   * @brief UTF-8 text transcoded to the sign's code page while it is copied
+   * @param fallback Written for characters the code page cannot show
+   */
+  void putUtf8(const char *text,
+               IbisCodePage page,
+               char fallback = IBIS_DEFAULT_FALLBACK) {
+    ibisTranscode(text, page, fallback, [this](char c) { put(c); });
+  }
+
+  void putRepeat(char c, size_t count) {
+    while (count--) put(c);
+  }
+
+  /**
+   * @brief Decimal number with leading zeros up to `digits`
+   */
+  void putNumber(uint16_t num, uint8_t digits) {
+    char tmp[5];
+    uint8_t n = 0;
+    do {
+      tmp[n++] = '0' + num % 10;
+      num /= 10;
+    } while (num > 0);
+    while (digits > n) {
+      put('0');
+      digits--;
+    }
+    while (n > 0) put(tmp[--n]);
+  }
+
+  /**
+   * @brief VDV hex: 0-15 map to 0-9 and :;<=>?, high nibble only if set
+   */
+  void putVdvHex(uint8_t value) {
+    if (value >> 4) put('0' + (value >> 4));
+    put('0' + (value & 0x0F));
+  }
+
+  /**
+   * @brief Append CR and parity; the telegram is then ready to send
+   */
+  void finish() {
+    _buf[_len] = 0x0D;
+    _buf[_len + 1] = _parity;
+  }
+
+  const uint8_t *data() const { return _buf; }
+  size_t length() const { return _len; }       // content only
+  size_t frameLength() const { return _len + 2; }  // with CR and parity
+  uint8_t parity() const { return _parity; }
+  bool overflowed() const { return _overflow; }
+
+private:
+  uint8_t _buf[Capacity + 2];
+  size_t _len = 0;
+  uint8_t _parity = IBIS_PARITY_SEED;
+  bool _overflow = false;
+};
+
+#endif  // IBIS_TELEGRAM_H
@@ -0,0 +1,54 @@
+#ifndef MONO_BITMAP_H
+#define MONO_BITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief 1 bit per pixel image in column-major order
+ *
+ * Each column takes `stride()` bytes; pixel (x, y) is bit y % 8 of byte
+ * y / 8 of column x, so the LSB is the topmost pixel of its byte. The
+ * buffer is owned by the caller.
+ */
+struct MonoBitmap {
+  uint16_t width = 0;
+  uint16_t height = 0;
+  uint8_t *data = nullptr;
+
+  MonoBitmap() = default;
+  MonoBitmap(uint16_t w, uint16_t h, uint8_t *buf)
+      : width(w), height(h), data(buf) {}
+
+  static constexpr size_t strideFor(uint16_t height) {
+    return (height + 7) / 8;
+  }
+  static constexpr size_t bytesFor(uint16_t width, uint16_t height) {
+    return width * strideFor(height);
+  }
+
+  size_t stride() const { return strideFor(height); }
+  size_t bytes() const { return bytesFor(width, height); }
+
+  void clear() { memset(data, 0, bytes()); }
+
+  /**
+   * @brief Pixels outside the bitmap read as off
+   */
+  bool get(int x, int y) const {
+    if (x < 0 || y < 0 || x >= width || y >= height) return false;
+    return (data[x * stride() + y / 8] >> (y % 8)) & 1;
+  }
+
+  void set(int x, int y, bool on) {
+    if (x < 0 || y < 0 || x >= width || y >= height) return;
+    uint8_t &byte = data[x * stride() + y / 8];
+    uint8_t mask = 1 << (y % 8);
+    byte = on ? (byte | mask) : (byte & ~mask);
+  }
+
+  const uint8_t *column(int x) const { return data + x * stride(); }
+};
+
+#endif  // MONO_BITMAP_H
@@ -0,0 +1,78 @@
+#ifndef MONO_DEFRAMER_H
+#define MONO_DEFRAMER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mono_encoder.h"
+
+/**
+ * @brief Splits a received MONO byte stream into frames, one byte at a time
+ *
+ * Undoes the escaping and checks the checksum when the closing delimiter
+ * arrives. Works whether frames share a delimiter or each has its own, and
+ * resynchronises on the next delimiter after noise.
+ */
+class MonoDeframer {
+public:
+  enum Result : uint8_t {
+    NONE,       // more bytes needed
+    FRAME,      // frame() holds a complete frame
+    BAD_FRAME,  // checksum mismatch, truncated escape or too long
+  };
+
+  Result feed(uint8_t byte) {
+    if (byte == MONO_FRAME_DELIMITER) {
+      size_t len = _len;
+      bool broken = _overrun || _escape;
+      _len = 0;
+      _escape = false;
+      _overrun = false;
+      if (len == 0) return NONE;  // opening delimiter
+      if (broken || len < 2) return BAD_FRAME;
+
+      // Either checksum leaves a fixed XOR over the whole frame
+      uint8_t x = 0;
+      for (size_t i = 0; i < len; i++) x ^= _buf[i];
+      if (x != 0xFF && x != 0xED) return BAD_FRAME;
+      _frameLen = len;
+      return FRAME;
+    }
+
+    if (_escape) {
+      byte ^= 0x20;
+      _escape = false;
+    } else if (byte == MONO_ESCAPE) {
+      _escape = true;
+      return NONE;
+    }
+    if (_len >= sizeof(_buf)) {
+      _overrun = true;
+      return NONE;
+    }
+    _buf[_len++] = byte;
+    return NONE;
+  }
+
+  void reset() {
+    _len = 0;
+    _escape = false;
+    _overrun = false;
+  }
+
+  /**
+   * @brief Last complete frame: command byte, payload and checksum
+   *
+   * Valid until the next byte is fed.
+   */
+  const uint8_t *frame() const { return _buf; }
+  size_t length() const { return _frameLen; }
+
+private:
+  uint8_t _buf[MONO_RAW_MAX];
+  size_t _len = 0;
+  size_t _frameLen = 0;
+  bool _escape = false;
+  bool _overrun = false;
+};
+
+#endif  // MONO_DEFRAMER_H
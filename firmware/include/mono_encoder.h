@@ -0,0 +1,358 @@
+#ifndef MONO_ENCODER_H
+#define MONO_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mono_bitmap.h"
+#include "mono_pack.h"
+#include "sign_transport.h"
+
+/*
+ * MONO bus protocol of LAWO/Alfa signs, as in
+ * alfa-bus-protocol/mono_protocol.py.
+ *
+ * A frame is 0x7E, command byte (command nibble | address), payload,
+ * checksum, 0x7E, where 0x7E and 0x7D inside the frame are escaped as
+ * 0x7D 0x5E and 0x7D 0x5D.
+ */
+
+#define MONO_FRAME_DELIMITER 0x7E
+#define MONO_ESCAPE 0x7D
+
+#define MONO_CMD_QUERY 0x80
+#define MONO_CMD_PRE_BITMAP_FLIPDOT 0x90
+#define MONO_CMD_COLUMN_DATA_FLIPDOT 0xA0
+#define MONO_CMD_PRE_BITMAP_LED_1 0xB0
+#define MONO_CMD_PRE_BITMAP_LED_2 0xC0
+#define MONO_CMD_BITMAP_DATA_LED 0xD0
+#define MONO_CMD_DISPLAY_BITMAP_LED 0xE0
+
+// Longest unescaped frame: bitmap data with 255 bytes of pixels
+#define MONO_RAW_MAX (1 + 2 + 255 + 1 + 1)
+// Worst case on the wire: everything escaped, plus both delimiters
+#define MONO_FRAME_MAX (2 * MONO_RAW_MAX + 2)
+
+// Flipdot column addresses skip 4 after every 28 columns (one panel)
+#define MONO_FLIPDOT_PANEL_COLUMNS 28
+#define MONO_FLIPDOT_PANEL_GAP 4
+
+enum MonoChecksum : uint8_t {
+  MONO_CHECKSUM_NONE,
+  MONO_CHECKSUM_LED,      // XOR of all bytes, starting from 0xED
+  MONO_CHECKSUM_FLIPDOT,  // 0xFF minus the XOR of all bytes
+};
+
+enum MonoSignType : uint8_t {
+  MONO_SIGN_FLIPDOT,
+  MONO_SIGN_LED,
+};
+
+inline uint8_t monoChecksumLed(const uint8_t *data, size_t len) {
+  uint8_t chk = 0xED;
+  for (size_t i = 0; i < len; i++) chk ^= data[i];
+  return chk;
+}
+
+inline uint8_t monoChecksumFlipdot(const uint8_t *data, size_t len) {
+  uint8_t x = 0;
+  for (size_t i = 0; i < len; i++) x ^= data[i];
+  return 0xFF - x;
+}
+
+/**
+ * @brief Encodes MONO frames into a preallocated buffer and writes them to a
+ * transport (see sign_transport.h)
+ *
+ * Escaping and both checksums are computed while the bytes are appended,
+ * and pixels are packed straight from the bitmap, so nothing but the one
+ * frame buffer is needed. The encoder does not pace frames; the .bin files
+ * produced by the desktop exporter have them back to back as well.
+ */
+template <typename Transport>
+class MonoEncoder {
+  static_assert(IsSignTransport<Transport>::value,
+                "Transport needs write(ByteSpan), flush() and now()");
+
+public:
+  explicit MonoEncoder(Transport &transport) : _transport(transport) {}
+
+  // Each returns the bytes written including delimiters, 0 on error
+
+  size_t query(uint8_t address) {
+    begin(MONO_CMD_QUERY, address);
+    return end(MONO_CHECKSUM_FLIPDOT);
+  }
+
+  /**
+   * @brief Any command with a payload, e.g. for commands not covered here
+   */
+  size_t command(uint8_t command,
+                 uint8_t address,
+                 const uint8_t *payload,
+                 size_t len,
+                 MonoChecksum checksum = MONO_CHECKSUM_FLIPDOT) {
+    if (len > MONO_RAW_MAX - 2) return 0;
+    begin(command, address);
+    for (size_t i = 0; i < len; i++) put(payload[i]);
+    return end(checksum);
+  }
+
+  // --- LED signs ---
+
+  /**
+   * @brief The two set-up commands sent before a bitmap
+   */
+  size_t ledPreBitmap(uint8_t address, uint16_t width, uint16_t height) {
+    static const uint8_t PRE_1[] = {0x00, 0xff, 0x2f, 0x10, 0x20, 0x40,
+                                    0x60, 0x90, 0xc0, 0xf0, 0x03, 0x13,
+                                    0x33, 0x53, 0x83, 0xb3, 0xe3, 0x89};
+    size_t imageBytes = MonoBitmap::bytesFor(width, height);
+    if (imageBytes > 255) return 0;
+
+    size_t total = command(MONO_CMD_PRE_BITMAP_LED_1, address, PRE_1,
+                           sizeof(PRE_1));
+    const uint8_t pre2[] = {0x01,
+                            0x00,
+                            0x00,
+                            0x00,
+                            0x00,
+                            0x00,
+                            (uint8_t)imageBytes,
+                            (uint8_t)((width + 3) / 4),
+                            (uint8_t)((height + 3) / 4)};
+    return total +
+           command(MONO_CMD_PRE_BITMAP_LED_2, address, pre2, sizeof(pre2));
+  }
+
+  /**
+   * @brief Bitmap data: per column from left to right, 8-pixel blocks from
+   * the bottom up, LSB the topmost pixel of the block
+   */
+  size_t ledBitmap(uint8_t address, const MonoBitmap &bitmap) {
+    size_t imageBytes = bitmap.bytes();
+    if (imageBytes > 255) return 0;
+
+    begin(MONO_CMD_BITMAP_DATA_LED, address);
+    put(0xFF);
+    put((uint8_t)imageBytes);
+    uint8_t dataChecksum = 0xED;
+    size_t stride = bitmap.stride();
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      const uint8_t *column = bitmap.column(x);
+      for (size_t block = stride; block-- > 0;) {
+        uint8_t byte = column[block];
+        // Rows below the bitmap's height are padding and stay dark
+        if (block == stride - 1 && bitmap.height % 8) {
+          byte &= (1 << (bitmap.height % 8)) - 1;
+        }
+        put(byte);
+        dataChecksum ^= byte;
+      }
+    }
+    put(dataChecksum);
+    return end(MONO_CHECKSUM_FLIPDOT);
+  }
+
+  size_t ledDisplay(uint8_t address) {
+    const uint8_t payload[] = {0x1a};
+    return command(MONO_CMD_DISPLAY_BITMAP_LED, address, payload,
+                   sizeof(payload));
+  }
+
+  /**
+   * @brief Full LED update: set-up, bitmap, display
+   */
+  size_t ledImage(uint8_t address, const MonoBitmap &bitmap) {
+    size_t pre = ledPreBitmap(address, bitmap.width, bitmap.height);
+    size_t data = pre ? ledBitmap(address, bitmap) : 0;
+    if (!data) return 0;
+    return pre + data + ledDisplay(address);
+  }
+
+  // --- Flipdot signs ---
+
+  size_t flipdotPreBitmap(uint8_t address) {
+    static const uint8_t PRE[] = {0x00, 0x10, 0x00, 0x50, 0x00, 0x02, 0x2E};
+    return command(MONO_CMD_PRE_BITMAP_FLIPDOT, address, PRE, sizeof(PRE));
+  }
+
+  /**
+   * @brief One column: 4 pixels per byte, topmost byte first; per pixel an
+   * enable bit (1 = flip) followed by its colour bit
+   */
+  size_t flipdotColumn(uint8_t address,
+                       uint8_t columnAddress,
+                       const uint8_t *data,
+                       size_t len) {
+    if (len > MONO_RAW_MAX - 4) return 0;
+    begin(MONO_CMD_COLUMN_DATA_FLIPDOT, address);
+    put(columnAddress);
+    for (size_t i = 0; i < len; i++) put(data[i]);
+    put(0x00);
+    return end(MONO_CHECKSUM_FLIPDOT);
+  }
+
+  /**
+   * @brief Column `x` of the bitmap in flipdot format, every dot enabled
+   * @param out Receives (height + 3) / 4 bytes
+   */
+  static size_t packFlipdotColumn(const MonoBitmap &bitmap,
+                                  uint16_t x,
+                                  uint8_t *out) {
+    size_t bytes = (bitmap.height + 3) / 4;
+    if (bitmap.height <= 64) {
+      // Pixels are numbered from the bottom row, 4 per byte; rows past the
+      // top are padding and read as black
+      uint64_t dots = monoColumnFromBottom(bitmap, x);
+      for (size_t i = 0; i < bytes; i++) {
+        uint8_t nibble = (dots >> ((bytes - 1 - i) * 4)) & 0x0F;
+        out[i] = 0xAA | MONO_FLIPDOT_SPREAD[nibble];
+      }
+      return bytes;
+    }
+    for (size_t i = 0; i < bytes; i++) {
+      uint8_t byte = 0xAA;  // all dots enabled, colour black
+      for (uint8_t bit = 0; bit < 4; bit++) {
+        // Pixels are numbered from the bottom row; rows past the top are
+        // padding and stay black
+        int y = (int)((bytes - 1 - i) * 4 + bit);
+        if (bitmap.get(x, bitmap.height - y - 1)) byte |= 1 << (6 - bit * 2);
+      }
+      out[i] = byte;
+    }
+    return bytes;
+  }
+
+  /**
+   * @brief Column `x` in flipdot format with only the dots that differ from
+   * `shown` enabled; the others get a skip pair (enable bit clear)
+   * @param out Receives (height + 3) / 4 bytes
+   * @return Number of dots that flip, 0 if the column is unchanged
+   */
+  static size_t packFlipdotColumnDiff(const MonoBitmap &bitmap,
+                                      const MonoBitmap &shown,
+                                      uint16_t x,
+                                      uint8_t *out) {
+    size_t bytes = (bitmap.height + 3) / 4;
+    if (bitmap.height <= 64) {
+      uint64_t dots = monoColumnFromBottom(bitmap, x);
+      uint64_t flips = dots ^ monoColumnFromBottom(shown, x);
+      for (size_t i = 0; i < bytes; i++) {
+        unsigned shift = (bytes - 1 - i) * 4;
+        uint8_t enable = (flips >> shift) & 0x0F;
+        uint8_t colour = (dots >> shift) & enable;
+        out[i] = MONO_FLIPDOT_SPREAD[enable] << 1 | MONO_FLIPDOT_SPREAD[colour];
+      }
+      return __builtin_popcountll(flips);
+    }
+    size_t changed = 0;
+    for (size_t i = 0; i < bytes; i++) {
+      uint8_t byte = 0x00;  // every dot skipped
+      for (uint8_t bit = 0; bit < 4; bit++) {
+        int y = bitmap.height - (int)((bytes - 1 - i) * 4 + bit) - 1;
+        bool on = bitmap.get(x, y);
+        if (y < 0 || on == shown.get(x, y)) continue;
+        byte |= (on ? 0x3 : 0x2) << (6 - bit * 2);
+        changed++;
+      }
+      out[i] = byte;
+    }
+    return changed;
+  }
+
+  /**
+   * @brief Column address of bitmap column `x`
+   */
+  static uint8_t flipdotColumnAddress(uint16_t x, uint8_t offset) {
+    return offset + x +
+           (x / MONO_FLIPDOT_PANEL_COLUMNS) * MONO_FLIPDOT_PANEL_GAP;
+  }
+
+  /**
+   * @brief Full flipdot update: set-up followed by every column
+   * @param columnOffset Address of the leftmost column
+   */
+  size_t flipdotImage(uint8_t address,
+                      const MonoBitmap &bitmap,
+                      uint8_t columnOffset = 0) {
+    uint8_t column[MONO_RAW_MAX - 4];
+    if ((size_t)(bitmap.height + 3) / 4 > sizeof(column)) return 0;
+
+    size_t total = flipdotPreBitmap(address);
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      size_t len = packFlipdotColumn(bitmap, x, column);
+      total += flipdotColumn(address, flipdotColumnAddress(x, columnOffset),
+                             column, len);
+    }
+    return total;
+  }
+
+  /**
+   * @brief Differential flipdot update against what the sign shows
+   *
+   * Columns whose bytes match `shown` are not sent at all, the others only
+   * enable the dots that flip. Both bitmaps must have the same size.
+   * @return Bytes written, 0 if nothing changed or on error
+   */
+  size_t flipdotUpdate(uint8_t address,
+                       const MonoBitmap &bitmap,
+                       const MonoBitmap &shown,
+                       uint8_t columnOffset = 0) {
+    uint8_t column[MONO_RAW_MAX - 4];
+    if ((size_t)(bitmap.height + 3) / 4 > sizeof(column)) return 0;
+    if (bitmap.width != shown.width || bitmap.height != shown.height) {
+      return 0;
+    }
+
+    size_t total = 0;
+    size_t stride = bitmap.stride();
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      if (memcmp(bitmap.column(x), shown.column(x), stride) == 0) continue;
+      // Padding bits may differ while every visible dot matches
+      if (!packFlipdotColumnDiff(bitmap, shown, x, column)) continue;
+      if (total == 0) total = flipdotPreBitmap(address);
+      total += flipdotColumn(address, flipdotColumnAddress(x, columnOffset),
+                             column, (bitmap.height + 3) / 4);
+    }
+    return total;
+  }
+
+private:
+  Transport &_transport;
+  uint8_t _frame[MONO_FRAME_MAX];
+  size_t _len = 0;
+  uint8_t _xor = 0;
+
+  void begin(uint8_t command, uint8_t address) {
+    _len = 0;
+    _xor = 0;
+    _frame[_len++] = MONO_FRAME_DELIMITER;
+    put((command & 0xF0) | (address & 0x0F));
+  }
+
+  void putEscaped(uint8_t byte) {
+    if (byte == MONO_FRAME_DELIMITER || byte == MONO_ESCAPE) {
+      _frame[_len++] = MONO_ESCAPE;
+      _frame[_len++] = byte ^ 0x20;
+    } else {
+      _frame[_len++] = byte;
+    }
+  }
+
+  void put(uint8_t byte) {
+    _xor ^= byte;
+    putEscaped(byte);
+  }
+
+  size_t end(MonoChecksum checksum) {
+    // The LED checksum seed 0xED folds into the running XOR
+    if (checksum == MONO_CHECKSUM_LED) putEscaped(_xor ^ 0xED);
+    if (checksum == MONO_CHECKSUM_FLIPDOT) putEscaped(0xFF - _xor);
+    _frame[_len++] = MONO_FRAME_DELIMITER;
+    _transport.write(ByteSpan{_frame, _len});
+    _transport.flush();
+    return _len;
+  }
+};
+
+#endif  // MONO_ENCODER_H
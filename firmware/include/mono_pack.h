@@ -0,0 +1,101 @@
+#ifndef MONO_PACK_H
+#define MONO_PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mono_bitmap.h"
+
+/*
+ * Packing kernels between bitmap layouts and MONO column data, working on
+ * whole words instead of single pixels.
+ */
+
+/**
+ * @brief Transpose an 8x8 bit matrix held in two words
+ *
+ * `hi` holds rows 0-3 and `lo` rows 4-7, row 0 in the top byte, MSB the
+ * leftmost column. Afterwards byte i (same order) is column i, with row 0
+ * in the MSB. Hacker's Delight, transpose8rS32.
+ */
+inline void monoTranspose8(uint32_t &hi, uint32_t &lo) {
+  uint32_t x = hi, y = lo, t;
+  t = (x ^ (x >> 7)) & 0x00AA00AA;
+  x = x ^ t ^ (t << 7);
+  t = (y ^ (y >> 7)) & 0x00AA00AA;
+  y = y ^ t ^ (t << 7);
+  t = (x ^ (x >> 14)) & 0x0000CCCC;
+  x = x ^ t ^ (t << 14);
+  t = (y ^ (y >> 14)) & 0x0000CCCC;
+  y = y ^ t ^ (t << 14);
+  t = (x & 0xF0F0F0F0) | ((y >> 4) & 0x0F0F0F0F);
+  y = ((x << 4) & 0xF0F0F0F0) | (y & 0x0F0F0F0F);
+  hi = t;
+  lo = y;
+}
+
+/**
+ * @brief Copy a row-major 1-bpp image (MSB leftmost, as PIL and the LAWO
+ * fonts store it) into a column-major MonoBitmap of the same size
+ *
+ * Works in 8x8 tiles: the tile's rows are loaded bottom row first, so
+ * after the transpose each column byte has the top row in its LSB.
+ * @param stride Bytes per source row, at least (width + 7) / 8
+ */
+inline void monoFromRows(const uint8_t *rows, size_t stride, MonoBitmap &dst) {
+  size_t dstStride = dst.stride();
+  for (uint16_t y0 = 0; y0 < dst.height; y0 += 8) {
+    uint8_t tileRows = dst.height - y0 < 8 ? dst.height - y0 : 8;
+    size_t block = y0 / 8;
+    for (uint16_t x0 = 0; x0 < dst.width; x0 += 8) {
+      const uint8_t *src = rows + y0 * stride + x0 / 8;
+      uint32_t hi = 0, lo = 0;
+      for (uint8_t r = 0; r < tileRows; r++) {
+        // Row r of the tile goes to matrix row 7 - r
+        uint8_t row = src[r * stride];
+        if (r >= 4) {
+          hi |= (uint32_t)row << (8 * (r - 4));
+        } else {
+          lo |= (uint32_t)row << (8 * r);
+        }
+      }
+      monoTranspose8(hi, lo);
+
+      uint8_t columns = dst.width - x0 < 8 ? dst.width - x0 : 8;
+      uint8_t *out = dst.data + x0 * dstStride + block;
+      for (uint8_t c = 0; c < columns; c++) {
+        uint32_t word = c < 4 ? hi : lo;
+        out[c * dstStride] = word >> (8 * (3 - (c & 3)));
+      }
+    }
+  }
+}
+
+// Bit p of a nibble moved to bit 6 - 2p (the colour bit of flipdot pixel
+// pair p); with << 1 the same pattern gives the enable bits
+static const uint8_t MONO_FLIPDOT_SPREAD[16] = {
+    0x00, 0x40, 0x10, 0x50, 0x04, 0x44, 0x14, 0x54,
+    0x01, 0x41, 0x11, 0x51, 0x05, 0x45, 0x15, 0x55};
+
+/**
+ * @brief Column `x` as a word, bit i = pixel i counted from the bottom row
+ *
+ * This is the order flipdot column data numbers its pixels in. Only for
+ * bitmaps up to 64 rows.
+ */
+inline uint64_t monoColumnFromBottom(const MonoBitmap &bitmap, uint16_t x) {
+  static const uint8_t REVERSE[16] = {0x0, 0x8, 0x4, 0xC, 0x2, 0xA, 0x6, 0xE,
+                                      0x1, 0x9, 0x5, 0xD, 0x3, 0xB, 0x7, 0xF};
+  if (bitmap.height == 0) return 0;
+  const uint8_t *column = bitmap.column(x);
+  size_t stride = bitmap.stride();
+  uint64_t reversed = 0;  // bit 63 - y = pixel y
+  for (size_t i = 0; i < stride; i++) {
+    uint8_t byte = column[i];
+    uint8_t rev = REVERSE[byte & 0x0F] << 4 | REVERSE[byte >> 4];
+    reversed |= (uint64_t)rev << (56 - 8 * i);
+  }
+  // Padding rows below the bitmap drop out with the shift
+  return reversed >> (64 - bitmap.height);
+}
+
+#endif  // MONO_PACK_H
@@ -0,0 +1,57 @@
+#ifndef MONO_WINDOW_H
+#define MONO_WINDOW_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "mono_bitmap.h"
+
+/*
+ * Bit-shifting copies between bitmaps: panel slices of a tiled canvas,
+ * marquee windows of a strip and LAWO glyph columns. No Arduino
+ * dependencies, so the native tests build them as they are.
+ */
+
+/**
+ * @brief Copy the window of `src` with its top left corner at (x, y) and
+ * the size of `dst` into `dst`
+ *
+ * `y` need not be a multiple of 8; rows are shifted into place a byte at a
+ * time. The window must lie within `src`; rows past `dst.height` are
+ * cleared in its last byte.
+ */
+void monoCopyWindow(const MonoBitmap &src,
+                    uint16_t x,
+                    uint16_t y,
+                    MonoBitmap &dst);
+
+/**
+ * @brief Fill `dst` with the columns of `src` from `offset` on, wrapping
+ * around every `cycle` columns
+ *
+ * Columns from `src.width` up to `cycle` are blank: the gap between the end
+ * of the content and its start coming round again. A cycle of 0 copies
+ * from column 0 without wrapping. Both bitmaps have the same height.
+ */
+void monoCopyColumnsWrapped(const MonoBitmap &src,
+                            uint32_t offset,
+                            uint32_t cycle,
+                            MonoBitmap &dst);
+
+/**
+ * @brief Up to 32 pixels of a row-major 1-bpp row (MSB leftmost), starting
+ * at pixel `bit`, left-aligned in the word
+ *
+ * Only the bytes holding them are read, so this stays within the row.
+ */
+uint32_t monoRowBits(const uint8_t *row, uint32_t bit, uint8_t count);
+
+/**
+ * @brief OR `bits` (bit 0 = top) into column `x` of `dst`, moved down by
+ * `y` rows
+ *
+ * Clipped on all four sides; rows past the height stay clear, encoders
+ * rely on it.
+ */
+void monoOrColumn(MonoBitmap &dst, int x, int y, uint32_t bits);
+
+#endif  // MONO_WINDOW_H
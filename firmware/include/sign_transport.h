@@ -0,0 +1,123 @@
+#ifndef SIGN_TRANSPORT_H
+#define SIGN_TRANSPORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Sign protocol encoders (IbisEncoder, IbisDs021tEncoder, ...) write their
+ * frames to a transport given as a template parameter, so the same code
+ * runs against the UART on the device and against memory on the host,
+ * with no virtual calls. A transport provides:
+ *
+ *   size_t write(ByteSpan bytes)  queue bytes, returns how many were taken
+ *   void flush()                  a frame is complete, push it out
+ *   uint32_t now()                monotonic milliseconds
+ */
+
+struct ByteSpan {
+  const uint8_t *data;
+  size_t size;
+};
+
+/**
+ * @brief True when T provides the transport interface above
+ */
+template <typename T, typename = void>
+struct IsSignTransport : std::false_type {};
+
+template <typename T>
+struct IsSignTransport<
+    T,
+    std::void_t<decltype(std::declval<T &>().write(ByteSpan{})),
+                decltype(std::declval<T &>().flush()),
+                decltype(std::declval<T &>().now())>>
+    : std::integral_constant<
+          bool,
+          std::is_convertible<decltype(std::declval<T &>().write(ByteSpan{})),
+                              size_t>::value &&
+              std::is_convertible<decltype(std::declval<T &>().now()),
+                                  uint32_t>::value> {};
+
+/**
+ * @brief Transport that records frames in a fixed buffer
+ *
+ * For host-side tests and benchmarks. The clock only moves with advance().
+ */
+template <size_t Capacity>
+class MemoryTransport {
+public:
+  size_t write(ByteSpan bytes) {
+    size_t n = bytes.size;
+    if (n > Capacity - _len) {
+      n = Capacity - _len;
+      _overflow = true;
+    }
+    memcpy(_buf + _len, bytes.data, n);
+    _len += n;
+    return n;
+  }
+
+  void flush() { _frames++; }
+  uint32_t now() { return _now; }
+
+  void advance(uint32_t ms) { _now += ms; }
+  void clear() {
+    _len = 0;
+    _frames = 0;
+    _overflow = false;
+  }
+
+  const uint8_t *data() const { return _buf; }
+  size_t length() const { return _len; }
+  size_t frames() const { return _frames; }
+  bool overflowed() const { return _overflow; }
+
+private:
+  uint8_t _buf[Capacity];
+  size_t _len = 0;
+  size_t _frames = 0;
+  uint32_t _now = 0;
+  bool _overflow = false;
+};
+
+/**
+ * @brief Transport that records frames in a caller-owned buffer
+ *
+ * MemoryTransport with the size chosen at run time, e.g. to encode a
+ * stream into PSRAM for caching. The clock does not move.
+ */
+class BufferTransport {
+public:
+  BufferTransport(uint8_t *buf, size_t capacity)
+      : _buf(buf), _capacity(capacity) {}
+
+  size_t write(ByteSpan bytes) {
+    size_t n = bytes.size;
+    if (n > _capacity - _len) {
+      n = _capacity - _len;
+      _overflow = true;
+    }
+    memcpy(_buf + _len, bytes.data, n);
+    _len += n;
+    return n;
+  }
+
+  void flush() {}
+  uint32_t now() { return 0; }
+
+  const uint8_t *data() const { return _buf; }
+  size_t length() const { return _len; }
+  bool overflowed() const { return _overflow; }
+
+private:
+  uint8_t *_buf;
+  size_t _capacity;
+  size_t _len = 0;
+  bool _overflow = false;
+};
+
+#endif  // SIGN_TRANSPORT_H
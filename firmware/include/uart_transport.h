@@ -0,0 +1,129 @@
+#ifndef UART_TRANSPORT_H
+#define UART_TRANSPORT_H
+
+#include <Arduino.h>
+#include <driver/uart.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "sign_transport.h"
+
+// Default ring sizes. The TX ring holds a whole sign update so a submit
+// never waits for the FIFO.
+#ifndef UART_TRANSPORT_TX_BUFFER
+#define UART_TRANSPORT_TX_BUFFER 8192
+#endif
+
+#ifndef UART_TRANSPORT_RX_BUFFER
+#define UART_TRANSPORT_RX_BUFFER 512
+#endif
+
+// RX line idle, in character times, that ends a received frame
+#ifndef UART_TRANSPORT_RX_IDLE_SYMBOLS
+#define UART_TRANSPORT_RX_IDLE_SYMBOLS 4
+#endif
+
+// Upper bound for flush(). The full TX ring at 1200 baud takes ~75 s to
+// drain; senders of long data wait with waitTxDone() sized by txPending().
+#ifndef UART_TRANSPORT_FLUSH_TIMEOUT_MS
+#define UART_TRANSPORT_FLUSH_TIMEOUT_MS 10000
+#endif
+
+struct UartTransportStats {
+  uint32_t submitted;     // bytes accepted for transmission
+  uint32_t rejected;      // submits refused because the ring was full
+  uint32_t rxFrames;      // RX bursts ended by line idle
+  uint32_t breaks;        // break conditions seen on RX
+  uint32_t rxOverflows;   // FIFO or ring overflows, input was dropped
+  uint32_t rxErrors;      // parity and framing errors
+};
+
+/**
+ * @brief Sign bus transport on the ESP-IDF UART driver
+ *
+ * Writes go into a large TX ring buffer that the driver drains from its
+ * interrupt handler, so callers do not block on the 128 byte FIFO. TX done
+ * comes from the UART's TX_DONE interrupt, RX frame ends from the
+ * hardware RX timeout, and line events (break, overflow, errors) from the
+ * driver's event queue.
+ *
+ * Implements the transport interface of sign_transport.h; flush() waits
+ * for TX done.
+ */
+class UartTransport {
+public:
+  typedef void (*RxFrameCallback)(void *ctx);
+
+  explicit UartTransport(uart_port_t port);
+
+  /**
+   * @brief Install the driver
+   * @param config Arduino serial config, e.g. SERIAL_7E2
+   * @param rxPin,txPin -1 leaves the pin unassigned
+   */
+  bool begin(uint32_t baud,
+             uint32_t config,
+             int8_t rxPin,
+             int8_t txPin,
+             size_t txBuffer = UART_TRANSPORT_TX_BUFFER,
+             size_t rxBuffer = UART_TRANSPORT_RX_BUFFER);
+
+  /**
+   * @brief Queue data for transmission without blocking
+   * @return false if the TX ring cannot take all of it; nothing is queued
+   */
+  bool submit(const uint8_t *data, size_t len);
+
+  /**
+   * @brief Queue data, waiting for ring space as needed
+   */
+  size_t write(const uint8_t *data, size_t len);
+
+  size_t write(ByteSpan bytes) { return write(bytes.data, bytes.size); }
+  void flush() { waitTxDone(UART_TRANSPORT_FLUSH_TIMEOUT_MS); }
+  uint32_t now() { return millis(); }
+
+  /**
+   * @brief Block until the last stop bit has left the UART
+   * @return false on timeout
+   */
+  bool waitTxDone(uint32_t timeoutMs);
+
+  /**
+   * @brief Bytes queued but not yet moved into the FIFO
+   */
+  size_t txPending();
+
+  /**
+   * @brief Read received bytes
+   *
+   * Returns once `len` bytes have arrived or none came for `timeoutMs`.
+   */
+  size_t read(uint8_t *buf, size_t len, uint32_t timeoutMs);
+
+  /**
+   * @brief Bytes received and waiting to be read
+   */
+  size_t available();
+
+  /**
+   * @brief Called from the event task whenever the RX line goes idle
+   */
+  void onRxFrame(RxFrameCallback callback, void *ctx);
+
+  UartTransportStats stats();
+
+private:
+  uart_port_t _port;
+  size_t _txBuffer = 0;
+  QueueHandle_t _events = nullptr;
+  RxFrameCallback _rxCallback = nullptr;
+  void *_rxCallbackCtx = nullptr;
+
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  UartTransportStats _stats = {};
+
+  static void eventTask(void *arg);
+};
+
+#endif  // UART_TRANSPORT_H
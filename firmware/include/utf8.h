@@ -0,0 +1,34 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Decode one UTF-8 sequence
+ * @param cp Receives the code point, U+FFFD for malformed input
+ * @return Bytes consumed (at least 1 unless at the terminator)
+ */
+inline size_t utf8Decode(const uint8_t *p, uint32_t &cp) {
+  // Sequence length by the lead byte's high nibble, 0 = invalid lead
+  static const uint8_t LENGTH[16] = {1, 1, 1, 1, 1, 1, 1, 1,
+                                     0, 0, 0, 0, 2, 2, 3, 4};
+  static const uint8_t MASK[5] = {0, 0x7F, 0x1F, 0x0F, 0x07};
+
+  uint8_t len = LENGTH[p[0] >> 4];
+  if (len == 0) {
+    cp = 0xFFFD;
+    return 1;
+  }
+  cp = p[0] & MASK[len];
+  for (uint8_t i = 1; i < len; i++) {
+    if ((p[i] & 0xC0) != 0x80) {  // also stops at the terminator
+      cp = 0xFFFD;
+      return i;
+    }
+    cp = (cp << 6) | (p[i] & 0x3F);
+  }
+  return len;
+}
+
+#endif  // UTF8_H
@@ -1,4 +1,5 @@
 #include "file_manager.h"
+#include <esp_heap_caps.h>
 
 bool FileManager::init() {
   if (!LittleFS.begin(false)) {
@@ -6,28 +7,348 @@ bool FileManager::init() {
     return false;
   }
   Serial.println("LittleFS Mounted");
+
+  if (mapCatalog()) {
+    Serial.printf("Catalog mapped from flash: %u routes\n",
+                  (unsigned)_header.routeCount);
+  } else if (openCatalog()) {
+    Serial.printf("Catalog opened: %u routes\n", (unsigned)_header.routeCount);
+  } else {
+    Serial.println("No binary catalog, using JSON files");
+  }
+  return true;
+}
+
+bool FileManager::checkHeader(size_t available) {
+  if (_header.magic != CATALOG_MAGIC || _header.version != CATALOG_VERSION ||
+      _header.headerSize != sizeof(CatalogHeader) ||
+      _header.busCount > _header.routeCount ||
+      _header.fileSize > available ||
+      _header.routeCount > _header.fileSize / sizeof(CatalogLookupEntry)) {
+    return false;
+  }
+
+  if (_header.offsetTable < sizeof(CatalogHeader) ||
+      _header.offsetTable > _header.fileSize ||
+      _header.lookupTable > _header.fileSize ||
+      _header.offsetTable % 4 != 0 || _header.lookupTable % 4 != 0) {
+    return false;
+  }
+
+  // Sizes are compared with the room after each table's start: offset +
+  // size could wrap past 4 GiB and land below fileSize. With routeCount at
+  // most fileSize / 8, the sizes themselves cannot overflow.
+  size_t offsetsSize = (_header.routeCount + 1) * sizeof(uint32_t);
+  size_t lookupSize = _header.routeCount * sizeof(CatalogLookupEntry);
+  return offsetsSize <= _header.fileSize - _header.offsetTable &&
+         lookupSize <= _header.fileSize - _header.lookupTable;
+}
+
+bool FileManager::checkOffsets() {
+  if (_offsets[_header.routeCount] > _header.fileSize) return false;
+  for (uint32_t i = 0; i < _header.routeCount; i++) {
+    if (_offsets[i + 1] < _offsets[i]) return false;
+  }
+  return true;
+}
+
+bool FileManager::mapCatalog() {
+  const esp_partition_t *part = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA,
+      (esp_partition_subtype_t)CATALOG_PARTITION_SUBTYPE, "catalog");
+  if (!part) return false;
+
+  const void *ptr;
+  if (esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr,
+                         &_mapHandle) != ESP_OK) {
+    Serial.println("catalog partition: mmap failed");
+    return false;
+  }
+  _mapped = (const uint8_t *)ptr;
+  memcpy(&_header, _mapped, sizeof(_header));
+
+  // An erased partition reads as 0xFF and simply fails the magic check
+  if (checkHeader(part->size)) {
+    _offsets = (const uint32_t *)(_mapped + _header.offsetTable);
+    _lookup = (const CatalogLookupEntry *)(_mapped + _header.lookupTable);
+
+    // Validate every record once so later lookups can use them unchecked
+    bool valid = checkOffsets();
+    for (uint32_t i = 0; valid && i < _header.routeCount; i++) {
+      valid = catalogRecordValid(
+          (const CatalogRecord *)(_mapped + _offsets[i]),
+          _offsets[i + 1] - _offsets[i]);
+    }
+    if (valid) {
+      _hasCatalog = true;
+      return true;
+    }
+    Serial.println("catalog partition: corrupt records");
+  }
+
+  esp_partition_munmap(_mapHandle);
+  _mapped = nullptr;
+  _offsets = nullptr;
+  _lookup = nullptr;
+  return false;
+}
+
+bool FileManager::openCatalog() {
+  if (!LittleFS.exists("/catalog.bin")) return false;
+
+  _catalog = LittleFS.open("/catalog.bin", "r");
+  if (!_catalog) return false;
+
+  size_t got = _catalog.read((uint8_t *)&_header, sizeof(_header));
+  if (got != sizeof(_header) || !checkHeader(_catalog.size())) {
+    Serial.println("catalog.bin: invalid header or version");
+    _catalog.close();
+    return false;
+  }
+
+  // Offset and lookup tables stay in RAM so a route lookup costs only one
+  // seek and one read of the record itself.
+  size_t offsetsSize = (_header.routeCount + 1) * sizeof(uint32_t);
+  size_t lookupSize = _header.routeCount * sizeof(CatalogLookupEntry);
+  _offsetsBuf.resize(_header.routeCount + 1);
+  _lookupBuf.resize(_header.routeCount);
+  _offsets = _offsetsBuf.data();
+  _lookup = _lookupBuf.data();
+
+  if (!_catalog.seek(_header.offsetTable) ||
+      _catalog.read((uint8_t *)_offsetsBuf.data(), offsetsSize) !=
+          offsetsSize ||
+      !_catalog.seek(_header.lookupTable) ||
+      _catalog.read((uint8_t *)_lookupBuf.data(), lookupSize) != lookupSize ||
+      !checkOffsets()) {
+    Serial.println("catalog.bin: truncated or corrupt tables");
+    _offsetsBuf.clear();
+    _lookupBuf.clear();
+    _offsets = nullptr;
+    _lookup = nullptr;
+    _catalog.close();
+    return false;
+  }
+
+  _hasCatalog = true;
   return true;
 }
 
-String FileManager::readFile(const String &path) {
+File FileManager::openFile(const String &path) {
   File file = LittleFS.open(path);
   if (!file) {
     Serial.printf("Failed to open file for reading: %s\n", path.c_str());
-    return "";
   }
-
-  String content = file.readString();
-  file.close();
-  return content;
+  return file;
 }
 
 bool FileManager::readIndex(IndexData &data) {
-  String content = readFile("/index.json");
-  if (content.isEmpty()) return false;
+  return _hasCatalog ? readCatalogIndex(data) : readJsonIndex(data);
+}
+
+bool FileManager::readRoute(const String &filename,
+                            RouteDetails &details,
+                            int type) {
+  return _hasCatalog ? readCatalogRoute(filename, details, type)
+                     : readJsonRoute(filename, details, type);
+}
+
+bool FileManager::readCatalogIndex(IndexData &data) {
+  data.buses.reserve(_header.busCount);
+  data.trams.reserve(_header.routeCount - _header.busCount);
+
+  if (_mapped) {
+    // Entries point straight into flash, nothing is copied
+    data.strings.attach((const char *)_mapped);
+    for (uint32_t i = 0; i < _header.routeCount; i++) {
+      const CatalogRecord *rec =
+          (const CatalogRecord *)(_mapped + _offsets[i]);
+      RouteEntry entry = {
+          (uint32_t)(catalogRecordName(rec) - (const char *)_mapped),
+          (uint32_t)(catalogRecordId(rec) - (const char *)_mapped),
+          rec->ibisLine, rec->ibisDestination};
+      (i < _header.busCount ? data.buses : data.trams).push_back(entry);
+    }
+    return true;
+  }
+
+  // Records are contiguous, so the whole index is one sequential pass
+  std::vector<uint8_t> buf;
+  if (!_catalog.seek(_offsets[0])) return false;
+
+  for (uint32_t i = 0; i < _header.routeCount; i++) {
+    size_t size = _offsets[i + 1] - _offsets[i];
+    buf.resize(size);
+    if (_catalog.read(buf.data(), size) != size) {
+      Serial.printf("readIndex: catalog record %u truncated\n", (unsigned)i);
+      return false;
+    }
 
-  JsonDocument doc;  // Dynamic size handling by ArduinoJson 7, or specify size
-                     // if strictly needed. V7 is recommended.
-  DeserializationError error = deserializeJson(doc, content);
+    const CatalogRecord *rec = (const CatalogRecord *)buf.data();
+    if (!catalogRecordValid(rec, size)) {
+      Serial.printf("readIndex: catalog record %u corrupt\n", (unsigned)i);
+      return false;
+    }
+
+    RouteEntry entry = {
+        data.strings.intern(catalogRecordName(rec), rec->nameLen),
+        data.strings.intern(catalogRecordId(rec), rec->idLen), rec->ibisLine,
+        rec->ibisDestination};
+    if (entry.name == StringArena::npos || entry.file == StringArena::npos) {
+      Serial.println("readIndex: out of memory for route names");
+      return false;
+    }
+    (i < _header.busCount ? data.buses : data.trams).push_back(entry);
+  }
+
+  data.strings.seal();
+  return true;
+}
+
+// Details storage goes to PSRAM when available so cached routes stay out of
+// the internal heap
+static std::shared_ptr<char> allocStorage(size_t size) {
+  void *ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  if (!ptr) ptr = heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+  return std::shared_ptr<char>((char *)ptr, heap_caps_free);
+}
+
+bool FileManager::readCatalogRoute(const String &id,
+                                   RouteDetails &details,
+                                   int type) {
+  uint32_t hash = catalogHash(id.c_str(), id.length());
+  uint32_t pos = catalogLowerBound(_lookup, _header.routeCount, hash);
+
+  // Loop only runs more than once on a hash collision
+  for (; pos < _header.routeCount && _lookup[pos].idHash == hash; pos++) {
+    uint32_t index = _lookup[pos].index;
+    if (index >= _header.routeCount) break;
+
+    const CatalogRecord *rec;
+    std::shared_ptr<char> storage;
+    if (_mapped) {
+      rec = (const CatalogRecord *)(_mapped + _offsets[index]);
+    } else {
+      size_t size = _offsets[index + 1] - _offsets[index];
+      storage = allocStorage(size);
+      if (!storage || !_catalog.seek(_offsets[index]) ||
+          _catalog.read((uint8_t *)storage.get(), size) != size) {
+        Serial.printf("readRoute: catalog record %u truncated\n",
+                      (unsigned)index);
+        return false;
+      }
+      rec = (const CatalogRecord *)storage.get();
+      if (!catalogRecordValid(rec, size)) {
+        Serial.printf("readRoute: catalog record %u corrupt\n",
+                      (unsigned)index);
+        return false;
+      }
+    }
+
+    if (rec->type != type || rec->idLen != id.length() ||
+        memcmp(catalogRecordId(rec), id.c_str(), rec->idLen) != 0) {
+      continue;
+    }
+
+    details.id = catalogRecordId(rec);
+    details.name = catalogRecordName(rec);
+    details.ibisLine = rec->ibisLine;
+    details.ibisDestination = rec->ibisDestination;
+    details.alfaSignText = catalogRecordText(rec);
+    details.alfaSignBinFile = catalogRecordBinFile(rec);
+    details.ibisFrames = catalogRecordIbis(rec);
+    details.ibisFramesLen = rec->ibisLen;
+    details.storage = storage;
+    return true;
+  }
+
+  Serial.printf("readRoute: %s not in catalog\n", id.c_str());
+  return false;
+}
+
+// Tracks the heap ArduinoJson holds so every JSON load can report its peak
+class JsonStatsAllocator : public ArduinoJson::Allocator {
+public:
+  size_t current = 0;
+  size_t peak = 0;
+
+  void *allocate(size_t size) override {
+    void *ptr = malloc(size);
+    if (ptr) grow(heap_caps_get_allocated_size(ptr));
+    return ptr;
+  }
+
+  void deallocate(void *ptr) override {
+    if (ptr) current -= heap_caps_get_allocated_size(ptr);
+    free(ptr);
+  }
+
+  void *reallocate(void *ptr, size_t size) override {
+    size_t before = ptr ? heap_caps_get_allocated_size(ptr) : 0;
+    void *out = realloc(ptr, size);
+    if (out) {
+      current -= before;
+      grow(heap_caps_get_allocated_size(out));
+    }
+    return out;
+  }
+
+private:
+  void grow(size_t size) {
+    current += size;
+    if (current > peak) peak = current;
+  }
+};
+
+// Older exports wrote the IBIS numbers as strings, newer ones as numbers
+static uint16_t jsonNumber(JsonVariant value) {
+  if (value.is<const char *>()) return atoi(value.as<const char *>());
+  return value.as<uint16_t>();
+}
+
+static size_t jsonLength(JsonVariant value) {
+  const char *str = value.as<const char *>();
+  return str ? strlen(str) + 1 : 1;
+}
+
+// Copies a JSON string into reserved storage and returns a view of it
+static const char *jsonCopy(JsonVariant value, char *&cursor) {
+  const char *str = value.as<const char *>();
+  size_t len = str ? strlen(str) : 0;
+  char *out = cursor;
+  memcpy(out, str ? str : "", len);
+  out[len] = '\0';
+  cursor += len + 1;
+  return out;
+}
+
+static uint32_t jsonIntern(JsonVariant value, StringArena &arena) {
+  const char *str = value.as<const char *>();
+  if (!str) str = "";
+  return arena.intern(str, strlen(str));
+}
+
+bool FileManager::readJsonIndex(IndexData &data) {
+  File file = openFile("/index.json");
+  if (!file) return false;
+
+  // Only the fields RouteEntry needs are kept, everything else in the
+  // stream is skipped by the parser without being stored.
+  JsonDocument filter;
+  for (const char *list : {"buses", "trams"}) {
+    filter[list][0]["name"] = true;
+    filter[list][0]["file"] = true;
+    filter[list][0]["ibisLineCmd"] = true;
+    filter[list][0]["ibisDestinationCmd"] = true;
+  }
+
+  JsonStatsAllocator stats;
+  JsonDocument doc(&stats);
+  unsigned long start = millis();
+  DeserializationError error =
+      deserializeJson(doc, file, DeserializationOption::Filter(filter));
+  unsigned long elapsed = millis() - start;
+  file.close();
 
   if (error) {
     Serial.print("readIndex: deserializeJson() failed: ");
@@ -36,33 +357,55 @@ bool FileManager::readIndex(IndexData &data) {
   }
 
   JsonArray buses = doc["buses"];
-  for (JsonObject bus : buses) {
-    RouteEntry entry;
-    entry.name = bus["name"].as<String>();
-    entry.file = bus["file"].as<String>();
-    data.buses.push_back(entry);
-  }
-
   JsonArray trams = doc["trams"];
-  for (JsonObject tram : trams) {
-    RouteEntry entry;
-    entry.name = tram["name"].as<String>();
-    entry.file = tram["file"].as<String>();
-    data.trams.push_back(entry);
+  Serial.printf("readIndex: %u routes parsed in %lu ms, peak %u bytes\n",
+                (unsigned)(buses.size() + trams.size()), elapsed,
+                (unsigned)stats.peak);
+
+  auto addRoutes = [&data](JsonArray routes, std::vector<RouteEntry> &out) {
+    out.reserve(routes.size());
+    for (JsonObject route : routes) {
+      RouteEntry entry = {jsonIntern(route["name"], data.strings),
+                          jsonIntern(route["file"], data.strings),
+                          jsonNumber(route["ibisLineCmd"]),
+                          jsonNumber(route["ibisDestinationCmd"])};
+      if (entry.name == StringArena::npos ||
+          entry.file == StringArena::npos) {
+        return false;
+      }
+      out.push_back(entry);
+    }
+    return true;
+  };
+
+  if (!addRoutes(buses, data.buses) || !addRoutes(trams, data.trams)) {
+    Serial.println("readIndex: out of memory for route names");
+    return false;
   }
 
+  data.strings.seal();
   return true;
 }
 
-bool FileManager::readRoute(const String &filename,
-                            RouteDetails &details,
-                            int type) {
+bool FileManager::readJsonRoute(const String &filename,
+                                RouteDetails &details,
+                                int type) {
   String path = (type == 0 ? "/buses/" : "/trams/") + filename + ".json";
-  String content = readFile(path);
-  if (content.isEmpty()) return false;
+  File file = openFile(path);
+  if (!file) return false;
+
+  JsonDocument filter;
+  filter["id"] = true;
+  filter["name"] = true;
+  filter["ibisLineCmd"] = true;
+  filter["ibisDestinationCmd"] = true;
+  filter["alfaSignText"] = true;
+  filter["alfaSignBinFile"] = true;
 
   JsonDocument doc;
-  DeserializationError error = deserializeJson(doc, content);
+  DeserializationError error =
+      deserializeJson(doc, file, DeserializationOption::Filter(filter));
+  file.close();
 
   if (error) {
     Serial.print("readRoute: deserializeJson() failed: ");
@@ -70,12 +413,19 @@ bool FileManager::readRoute(const String &filename,
     return false;
   }
 
-  details.id = doc["id"].as<String>();
-  details.name = doc["name"].as<String>();
-  details.ibisLineCmd = doc["ibisLineCmd"].as<String>();
-  details.ibisDestinationCmd = doc["ibisDestinationCmd"].as<String>();
-  details.alfaSignText = doc["alfaSignText"].as<String>();
-  details.alfaSignBinFile = doc["alfaSignBinFile"].as<String>();
+  size_t total = jsonLength(doc["id"]) + jsonLength(doc["name"]) +
+                 jsonLength(doc["alfaSignText"]) +
+                 jsonLength(doc["alfaSignBinFile"]);
+  details.storage = allocStorage(total);
+  if (!details.storage) return false;
+  char *cursor = details.storage.get();
+
+  details.id = jsonCopy(doc["id"], cursor);
+  details.name = jsonCopy(doc["name"], cursor);
+  details.ibisLine = jsonNumber(doc["ibisLineCmd"]);
+  details.ibisDestination = jsonNumber(doc["ibisDestinationCmd"]);
+  details.alfaSignText = jsonCopy(doc["alfaSignText"], cursor);
+  details.alfaSignBinFile = jsonCopy(doc["alfaSignBinFile"], cursor);
 
   return true;
 }
@@ -1,35 +1,86 @@
 #pragma once
 #include <Arduino.h>
 #include <ArduinoJson.h>
+#include <memory>
 #include <vector>
 #include <LittleFS.h>
+#include <esp_partition.h>
+#include "route_catalog.h"
+#include "string_arena.h"
 
+// Index entries hold offsets into IndexData::strings, which is either an
+// interned arena or the mapped catalog partition itself.
 struct RouteEntry {
-  String name;
-  String file;  // effectively the ID
+  uint32_t name;
+  uint32_t file;  // effectively the ID
+  uint16_t ibisLine;
+  uint16_t ibisDestination;
 };
 
 struct IndexData {
   std::vector<RouteEntry> buses;
   std::vector<RouteEntry> trams;
+  StringArena strings;
+
+  const char *name(const RouteEntry &entry) const {
+    return strings.at(entry.name);
+  }
+  const char *file(const RouteEntry &entry) const {
+    return strings.at(entry.file);
+  }
 };
 
+// Details are views into the mapped partition or into their own storage
 struct RouteDetails {
-  String id;
-  String name;
-  String ibisLineCmd;
-  String ibisDestinationCmd;
-  String alfaSignText;
-  String alfaSignBinFile;
+  const char *id = "";
+  const char *name = "";
+  uint16_t ibisLine = 0;
+  uint16_t ibisDestination = 0;
+  const char *alfaSignText = "";
+  const char *alfaSignBinFile = "";
+  // Framed IBIS telegrams from the catalog, empty for JSON routes
+  const uint8_t *ibisFrames = nullptr;
+  size_t ibisFramesLen = 0;
+  // Backing strings when not mapped, shared so copies stay valid
+  std::shared_ptr<char> storage;
 };
 
 class FileManager {
 public:
+  /**
+   * @brief Mount LittleFS and open the route catalog
+   *
+   * Sources in order of preference: the memory-mapped "catalog" partition,
+   * /catalog.bin on LittleFS, then the JSON files.
+   */
   bool init();
   bool readIndex(IndexData &data);
   // type: 0 for bus, 1 for tram. Used to determine directory.
   bool readRoute(const String &filename, RouteDetails &details, int type);
 
 private:
-  String readFile(const String &path);
+  // Catalog partition mapped into the data address space
+  const uint8_t *_mapped = nullptr;
+  esp_partition_mmap_handle_t _mapHandle;
+
+  // Binary catalog file, used when the partition is empty
+  File _catalog;
+  bool _hasCatalog = false;
+  CatalogHeader _header;
+  const uint32_t *_offsets = nullptr;
+  const CatalogLookupEntry *_lookup = nullptr;
+  std::vector<uint32_t> _offsetsBuf;
+  std::vector<CatalogLookupEntry> _lookupBuf;
+
+  bool mapCatalog();
+  bool openCatalog();
+  bool checkHeader(size_t available);
+  bool checkOffsets();
+  bool readCatalogIndex(IndexData &data);
+  bool readCatalogRoute(const String &id, RouteDetails &details, int type);
+
+  bool readJsonIndex(IndexData &data);
+  bool readJsonRoute(const String &filename, RouteDetails &details, int type);
+
+  File openFile(const String &path);
 };
@@ -0,0 +1,122 @@
+#include "flipdot_sender.h"
+#include <esp_heap_caps.h>
+
+FlipdotSender::FlipdotSender(MonoLink &link)
+    : _link(link), _encoder(link) {}
+
+FlipdotSender::~FlipdotSender() {
+  for (Shadow &shadow : _shadows) heap_caps_free(shadow.data);
+}
+
+bool FlipdotSender::reserve(Shadow &shadow, const MonoBitmap &image) {
+  if (shadow.data && shadow.width == image.width &&
+      shadow.height == image.height) {
+    return true;
+  }
+  heap_caps_free(shadow.data);
+  shadow.data = (uint8_t *)heap_caps_malloc(image.bytes(), MALLOC_CAP_SPIRAM);
+  if (!shadow.data) {
+    shadow.data =
+        (uint8_t *)heap_caps_malloc(image.bytes(), MALLOC_CAP_DEFAULT);
+  }
+  shadow.width = image.width;
+  shadow.height = image.height;
+  return shadow.data != nullptr;
+}
+
+size_t FlipdotSender::encodeFull(uint8_t address,
+                                 const MonoBitmap &image,
+                                 uint8_t columnOffset,
+                                 uint8_t *out,
+                                 size_t capacity) {
+  BufferTransport buffer(out, capacity);
+  MonoEncoder<BufferTransport> encoder(buffer);
+  size_t total = encoder.flipdotImage(address, image, columnOffset);
+  return buffer.overflowed() ? capacity + 1 : total;
+}
+
+size_t FlipdotSender::send(uint8_t address,
+                           const MonoBitmap &image,
+                           uint8_t columnOffset,
+                           ByteSpan full) {
+  if (!_link.present(address)) return 0;
+  Shadow &shadow = _shadows[address & 0x0F];
+
+  // A new size or column offset means the shadow does not describe the
+  // same dots any more
+  bool sameLayout = shadow.data && shadow.width == image.width &&
+                    shadow.height == image.height &&
+                    shadow.columnOffset == columnOffset;
+  portENTER_CRITICAL(&_mux);
+  bool diff = shadow.valid && sameLayout;
+  uint32_t epoch = shadow.epoch;
+  portEXIT_CRITICAL(&_mux);
+
+  size_t total;
+  if (diff) {
+    MonoBitmap shown(shadow.width, shadow.height, shadow.data);
+    total = _encoder.flipdotUpdate(address, image, shown, columnOffset);
+  } else if (full.size) {
+    total = _link.writeFrames(full);
+  } else {
+    total = _encoder.flipdotImage(address, image, columnOffset);
+  }
+
+  if (!diff && total == 0) return 0;  // image too tall, nothing was sent
+
+  if (!reserve(shadow, image)) {
+    Serial.printf("Flipdot: no memory for the shadow of address %u\n",
+                  (unsigned)address);
+    return total;
+  }
+  memcpy(shadow.data, image.data, image.bytes());
+  shadow.columnOffset = columnOffset;
+
+  // An invalidation while the frames were going out wins
+  portENTER_CRITICAL(&_mux);
+  shadow.valid = shadow.epoch == epoch;
+  if (!diff) {
+    _stats.fullUpdates++;
+  } else if (total == 0) {
+    _stats.unchanged++;
+  } else {
+    _stats.diffUpdates++;
+  }
+  _stats.bytesSent += total;
+  portEXIT_CRITICAL(&_mux);
+  return total;
+}
+
+void FlipdotSender::invalidate(uint8_t address) {
+  Shadow &shadow = _shadows[address & 0x0F];
+  portENTER_CRITICAL(&_mux);
+  if (shadow.valid) _stats.invalidations++;
+  shadow.valid = false;
+  shadow.epoch++;
+  portEXIT_CRITICAL(&_mux);
+}
+
+void FlipdotSender::invalidateAll() {
+  for (uint8_t address = 0; address < FLIPDOT_ADDRESSES; address++) {
+    invalidate(address);
+  }
+}
+
+void FlipdotSender::onReply(uint8_t address, bool answered) {
+  if (!answered) invalidate(address);
+}
+
+void FlipdotSender::on_link_reply(void *ctx,
+                                  uint8_t command,
+                                  uint8_t address,
+                                  const uint8_t *reply,
+                                  size_t len) {
+  ((FlipdotSender *)ctx)->onReply(address, reply != nullptr);
+}
+
+FlipdotStats FlipdotSender::stats() {
+  portENTER_CRITICAL(&_mux);
+  FlipdotStats copy = _stats;
+  portEXIT_CRITICAL(&_mux);
+  return copy;
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <Arduino.h>
+#include "mono_encoder.h"
+#include "mono_link.h"
+
+// MONO addresses are one nibble
+#define FLIPDOT_ADDRESSES 16
+
+struct FlipdotStats {
+  uint32_t fullUpdates;
+  uint32_t diffUpdates;
+  uint32_t unchanged;      // updates that matched the shadow, nothing sent
+  uint32_t invalidations;
+  uint32_t bytesSent;
+};
+
+/**
+ * @brief Sends images to flipdot signs, flipping only the dots that change
+ *
+ * Keeps a shadow of what each address shows. While the shadow is valid an
+ * update sends just the changed columns with only the flipping dots
+ * enabled; otherwise, or when the size changes, every dot is sent.
+ * Frames are queued on the MONO link; send() is meant for one task (the
+ * I/O worker), the invalidate calls may come from any task.
+ */
+class FlipdotSender {
+public:
+  explicit FlipdotSender(MonoLink &link);
+  ~FlipdotSender();
+
+  /**
+   * @brief Show `image` on the sign at `address`
+   * @param columnOffset Address of the sign's leftmost column
+   * @param full Frames of a full update of `image`, if already encoded;
+   * sent instead of encoding them when a full update is needed
+   * @return Bytes queued, 0 if nothing had to change or on error
+   */
+  size_t send(uint8_t address,
+              const MonoBitmap &image,
+              uint8_t columnOffset = 0,
+              ByteSpan full = ByteSpan{nullptr, 0});
+
+  /**
+   * @brief Encode a full update of `image` into `out`
+   * @return Bytes needed; nothing usable was written if more than `capacity`
+   */
+  static size_t encodeFull(uint8_t address,
+                           const MonoBitmap &image,
+                           uint8_t columnOffset,
+                           uint8_t *out,
+                           size_t capacity);
+
+  /**
+   * @brief Forget what the sign shows; the next update is a full one
+   */
+  void invalidate(uint8_t address);
+  void invalidateAll();
+
+  /**
+   * @brief Result of a query or of any command that expects a reply
+   *
+   * A sign that did not answer may have been power cycled or had its
+   * panels cleared, so what it shows is no longer known.
+   */
+  void onReply(uint8_t address, bool answered);
+
+  /**
+   * @brief MonoLink::ReplyCallback, ctx is the FlipdotSender
+   */
+  static void on_link_reply(void *ctx,
+                            uint8_t command,
+                            uint8_t address,
+                            const uint8_t *reply,
+                            size_t len);
+
+  /**
+   * @brief Block until the link has sent everything queued
+   */
+  bool waitSent(uint32_t timeoutMs) { return _link.waitIdle(timeoutMs); }
+
+  FlipdotStats stats();
+
+private:
+  struct Shadow {
+    uint8_t *data = nullptr;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    uint8_t columnOffset = 0;
+    bool valid = false;
+    uint32_t epoch = 0;  // bumped by invalidate() during a send
+  };
+
+  MonoLink &_link;
+  MonoEncoder<MonoLink> _encoder;
+  Shadow _shadows[FLIPDOT_ADDRESSES];
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  FlipdotStats _stats = {};
+
+  bool reserve(Shadow &shadow, const MonoBitmap &image);
+};
@@ -0,0 +1,181 @@
+#include "frame_cache.h"
+#include <LittleFS.h>
+#include <algorithm>
+#include <esp_heap_caps.h>
+
+#define FRAME_CACHE_MAGIC 0x31434650  // "PFC1"
+
+struct FrameFileHeader {
+  uint32_t magic;
+  uint32_t seq;  // insertion order, restores the LRU order
+  uint64_t key;
+  uint32_t len;
+  uint32_t check;  // FNV-1a of the data
+};
+
+static uint32_t checksum(const uint8_t *data, size_t len) {
+  uint32_t hash = 0x811C9DC5;
+  for (size_t i = 0; i < len; i++) hash = (hash ^ data[i]) * 0x01000193;
+  return hash;
+}
+
+static std::shared_ptr<uint8_t> allocBlob(size_t size) {
+  void *ptr = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  if (!ptr) ptr = heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+  return std::shared_ptr<uint8_t>((uint8_t *)ptr, heap_caps_free);
+}
+
+FrameCache::FrameCache(size_t budget) : _budget(budget) {}
+
+String FrameCache::pathFor(uint64_t key) {
+  char name[40];
+  snprintf(name, sizeof(name), FRAME_CACHE_DIR "/%08lx%08lx",
+           (unsigned long)(key >> 32), (unsigned long)(uint32_t)key);
+  return String(name);
+}
+
+bool FrameCache::begin() {
+  _lock = xSemaphoreCreateMutex();
+  if (!_lock) return false;
+
+  if (!LittleFS.exists(FRAME_CACHE_DIR)) LittleFS.mkdir(FRAME_CACHE_DIR);
+  File dir = LittleFS.open(FRAME_CACHE_DIR);
+  if (!dir || !dir.isDirectory()) return false;
+
+  // Collect the paths first, the directory must not change while listed
+  std::vector<String> paths;
+  for (File file = dir.openNextFile(); file; file = dir.openNextFile()) {
+    paths.push_back(String(FRAME_CACHE_DIR "/") + file.name());
+  }
+  dir.close();
+  for (const String &path : paths) {
+    if (!restore(path)) LittleFS.remove(path.c_str());
+  }
+
+  // Saved entries may exceed a budget lowered since
+  evictFor(0);
+  Serial.printf("Frame cache: %u entries, %u bytes restored\n",
+                (unsigned)_entries.size(), (unsigned)_bytes);
+  return true;
+}
+
+bool FrameCache::restore(const String &path) {
+  File file = LittleFS.open(path, "r");
+  if (!file) return false;
+
+  FrameFileHeader header;
+  bool ok = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) &&
+            header.magic == FRAME_CACHE_MAGIC &&
+            file.size() == sizeof(header) + header.len &&
+            header.len <= _budget && pathFor(header.key) == path;
+  FrameBlob blob;
+  if (ok) {
+    blob.data = allocBlob(header.len);
+    blob.len = header.len;
+    ok = blob.data && file.read(blob.data.get(), header.len) == header.len &&
+         checksum(blob.data.get(), header.len) == header.check;
+  }
+  file.close();
+  if (!ok) return false;
+
+  insert(header.key, header.seq, blob, true);
+  _clock = max(_clock, header.seq + 1);
+  _stats.restored++;
+  return true;
+}
+
+bool FrameCache::get(uint64_t key, FrameBlob &blob) {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  for (Entry &entry : _entries) {
+    if (entry.key != key) continue;
+    entry.lastUse = _clock++;
+    blob = entry.blob;
+    _stats.hits++;
+    xSemaphoreGive(_lock);
+    return true;
+  }
+  _stats.misses++;
+  xSemaphoreGive(_lock);
+  return false;
+}
+
+bool FrameCache::put(uint64_t key,
+                     const uint8_t *data,
+                     size_t len,
+                     bool persist) {
+  if (len == 0 || len > _budget) return false;
+  FrameBlob blob;
+  blob.data = allocBlob(len);
+  if (!blob.data) return false;
+  memcpy(blob.data.get(), data, len);
+  blob.len = len;
+  return put(key, blob, persist);
+}
+
+bool FrameCache::put(uint64_t key, const FrameBlob &blob, bool persist) {
+  if (!blob.data || blob.len == 0 || blob.len > _budget) return false;
+
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  auto it = std::find_if(_entries.begin(), _entries.end(),
+                         [key](const Entry &e) { return e.key == key; });
+  if (it != _entries.end()) {
+    _bytes -= it->blob.len;
+    if (it->persisted && !persist) LittleFS.remove(pathFor(key).c_str());
+    _entries.erase(it);
+  }
+  evictFor(blob.len);
+  uint32_t seq = _clock++;
+  insert(key, seq, blob, persist);
+  xSemaphoreGive(_lock);
+
+  // Written outside the lock; a failed save only costs the reboot copy
+  if (persist && !save(key, seq, blob.data.get(), blob.len)) {
+    Serial.println("Frame cache: failed to save entry to flash");
+  }
+  return true;
+}
+
+FrameCacheStats FrameCache::stats() {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  FrameCacheStats copy = _stats;
+  copy.bytes = _bytes;
+  xSemaphoreGive(_lock);
+  return copy;
+}
+
+void FrameCache::insert(uint64_t key,
+                        uint32_t seq,
+                        FrameBlob blob,
+                        bool persisted) {
+  _bytes += blob.len;
+  _entries.push_back({key, seq, persisted, blob});
+}
+
+void FrameCache::evictFor(size_t len) {
+  while (!_entries.empty() && _bytes + len > _budget) {
+    auto oldest = std::min_element(
+        _entries.begin(), _entries.end(),
+        [](const Entry &a, const Entry &b) { return a.lastUse < b.lastUse; });
+    _bytes -= oldest->blob.len;
+    if (oldest->persisted) LittleFS.remove(pathFor(oldest->key).c_str());
+    _entries.erase(oldest);
+    _stats.evictions++;
+  }
+}
+
+bool FrameCache::save(uint64_t key,
+                      uint32_t seq,
+                      const uint8_t *data,
+                      size_t len) {
+  FrameFileHeader header = {FRAME_CACHE_MAGIC, seq, key, (uint32_t)len,
+                            checksum(data, len)};
+  String path = pathFor(key);
+  File file = LittleFS.open(path, "w");
+  if (!file) return false;
+  bool ok = file.write((const uint8_t *)&header, sizeof(header)) ==
+                sizeof(header) &&
+            file.write(data, len) == len;
+  file.close();
+  if (!ok) LittleFS.remove(path.c_str());
+  return ok;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <memory>
+#include <vector>
+
+// PSRAM held by cached streams; flash holds a copy of the persisted ones
+#ifndef FRAME_CACHE_BUDGET
+#define FRAME_CACHE_BUDGET (256 * 1024)
+#endif
+
+#ifndef FRAME_CACHE_DIR
+#define FRAME_CACHE_DIR "/framecache"
+#endif
+
+/**
+ * @brief 64-bit FNV-1a over everything that decides a sign's bytes
+ *
+ * Fields are fed one by one; strings include their terminator so that
+ * ("ab", "c") and ("a", "bc") hash differently.
+ */
+class FrameKey {
+public:
+  FrameKey &add(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) _hash = (_hash ^ p[i]) * 0x100000001B3ULL;
+    return *this;
+  }
+  FrameKey &add(const char *text) { return add(text, strlen(text) + 1); }
+  FrameKey &add(uint32_t value) { return add(&value, sizeof(value)); }
+
+  uint64_t value() const { return _hash; }
+
+private:
+  uint64_t _hash = 0xCBF29CE484222325ULL;
+};
+
+struct FrameBlob {
+  std::shared_ptr<uint8_t> data;  // stays valid after eviction
+  size_t len = 0;
+};
+
+struct FrameCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  uint32_t restored;  // entries loaded from flash at boot
+  uint32_t bytes;     // PSRAM in use
+};
+
+/**
+ * @brief Content-addressed cache of ready-to-send sign byte streams
+ *
+ * Entries are whole, framed and escaped streams keyed by a FrameKey over
+ * their inputs (text, font, geometry, sign type, or a source file), so a
+ * hit can go to the bus without reading or rendering anything. Blobs live
+ * in PSRAM under a byte budget with LRU eviction, and rendered or encoded
+ * ones are written through to FRAME_CACHE_DIR on LittleFS so the cache
+ * survives a reboot.
+ */
+class FrameCache {
+public:
+  explicit FrameCache(size_t budget = FRAME_CACHE_BUDGET);
+
+  /**
+   * @brief Create the lock and restore the entries saved on flash
+   *
+   * LittleFS must be mounted. Entries come back in the order they were
+   * added; hits since then are not remembered across a reboot.
+   */
+  bool begin();
+
+  bool get(uint64_t key, FrameBlob &blob);
+
+  /**
+   * @brief Cache a copy of `data`, evicting the least recently used
+   * @param persist Also write it to flash. Streams that are copies of a
+   *        file on LittleFS would only double its flash use.
+   * @return false if it is larger than the budget or out of memory
+   */
+  bool put(uint64_t key, const uint8_t *data, size_t len, bool persist = true);
+
+  /**
+   * @brief Cache a blob without copying it; it must not change afterwards
+   */
+  bool put(uint64_t key, const FrameBlob &blob, bool persist = true);
+
+  FrameCacheStats stats();
+
+private:
+  struct Entry {
+    uint64_t key;
+    uint32_t lastUse;
+    bool persisted;  // has a copy in FRAME_CACHE_DIR
+    FrameBlob blob;
+  };
+
+  size_t _budget;
+  size_t _bytes = 0;
+  uint32_t _clock = 0;
+  std::vector<Entry> _entries;
+  FrameCacheStats _stats = {};
+  SemaphoreHandle_t _lock = nullptr;
+
+  void insert(uint64_t key, uint32_t seq, FrameBlob blob, bool persisted);
+  void evictFor(size_t len);
+  bool save(uint64_t key, uint32_t seq, const uint8_t *data, size_t len);
+  bool restore(const String &path);
+  static String pathFor(uint64_t key);
+};
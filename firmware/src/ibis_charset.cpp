@@ -0,0 +1,113 @@
+#include "ibis_charset.h"
+
+// Cyrillic А..Я (U+0410..U+042F), Ukrainian national transliteration.
+// Lower case input is transliterated to lower case.
+static const char CYRILLIC_TRANSLIT[32][IBIS_CHAR_MAX + 1] = {
+    "A",  "B",  "V",  "H",  "D",    "E", "Zh", "Z",  // А Б В Г Д Е Ж З
+    "Y",  "Y",  "K",  "L",  "M",    "N", "O",  "P",  // И Й К Л М Н О П
+    "R",  "S",  "T",  "U",  "F",    "Kh", "Ts", "Ch",  // Р С Т У Ф Х Ц Ч
+    "Sh", "Shch", "", "Y",  "",     "E", "Yu", "Ya",  // Ш Щ Ъ Ы Ь Э Ю Я
+};
+
+// Cyrillic А..Я in KOI-7 N2. Ъ has no code, it shares Ь.
+static const uint8_t CYRILLIC_KOI7[32] = {
+    0x61, 0x62, 0x77, 0x67, 0x64, 0x65, 0x76, 0x7A,  // А Б В Г Д Е Ж З
+    0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70,  // И Й К Л М Н О П
+    0x72, 0x73, 0x74, 0x75, 0x66, 0x68, 0x63, 0x7E,  // Р С Т У Ф Х Ц Ч
+    0x7B, 0x7D, 0x78, 0x79, 0x78, 0x7C, 0x60, 0x71,  // Ш Щ Ъ Ы Ь Э Ю Я
+};
+
+struct IbisCharMapping {
+  uint16_t cp;
+  char din66003[IBIS_CHAR_MAX + 1];
+  char koi7[IBIS_CHAR_MAX + 1];
+};
+
+// Everything outside ASCII and Cyrillic А..я, sorted by code point. Only
+// upper case letters are listed, lower case is folded before the lookup.
+static const IbisCharMapping MAPPINGS[] = {
+    {0x00A0, " ", " "},
+    {0x00AB, "\"", "\""},   // «
+    {0x00BB, "\"", "\""},   // »
+    {0x00C4, "[", "AE"},    // Ä
+    {0x00D6, "\\", "OE"},   // Ö
+    {0x00DC, "]", "UE"},    // Ü
+    {0x00DF, "~", "SS"},    // ß
+    {0x00E4, "{", "AE"},    // ä
+    {0x00F6, "|", "OE"},    // ö
+    {0x00FC, "}", "UE"},    // ü
+    {0x02BC, "'", "'"},     // Ukrainian apostrophe
+    {0x0401, "Yo", "\x65"}, // Ё as Е
+    {0x0404, "Ye", "\x65"}, // Є as Е
+    {0x0406, "I", "I"},     // І
+    {0x0407, "Yi", "I"},    // Ї
+    {0x0490, "G", "\x67"},  // Ґ as Г
+    {0x2013, "-", "-"},
+    {0x2014, "-", "-"},
+    {0x2018, "'", "'"},
+    {0x2019, "'", "'"},
+    {0x201C, "\"", "\""},
+    {0x201D, "\"", "\""},
+    {0x201E, "\"", "\""},
+    {0x2116, "N", "N"},     // №
+};
+
+static const IbisCharMapping *findMapping(uint32_t cp) {
+  size_t lo = 0, hi = sizeof(MAPPINGS) / sizeof(MAPPINGS[0]);
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (MAPPINGS[mid].cp < cp)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return (lo < sizeof(MAPPINGS) / sizeof(MAPPINGS[0]) && MAPPINGS[lo].cp == cp)
+             ? &MAPPINGS[lo]
+             : nullptr;
+}
+
+static int copyMapping(const char *str, bool lower, char *out) {
+  int n = 0;
+  for (; str[n]; n++) {
+    char c = str[n];
+    out[n] = (lower && c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+  }
+  return n;
+}
+
+int ibisMapCodepoint(IbisCodePage page, uint32_t cp, char *out) {
+  bool koi7 = (page == IBIS_CODEPAGE_KOI7);
+
+  if (cp < 0x80) {
+    if (koi7 && cp >= 0x60 && cp < 0x7F) {
+      // 0x60-0x7E hold Cyrillic, Latin is upper case only
+      if (cp < 'a' || cp > 'z') return -1;
+      cp -= 'a' - 'A';
+    }
+    out[0] = (char)cp;
+    return 1;
+  }
+
+  // Fold Cyrillic lower case onto upper case
+  bool lower = false;
+  if (cp >= 0x0430 && cp <= 0x044F) {
+    cp -= 0x20;
+    lower = true;
+  } else if ((cp >= 0x0450 && cp <= 0x045F) || cp == 0x0491) {
+    cp -= (cp == 0x0491) ? 1 : 0x50;
+    lower = true;
+  }
+
+  if (cp >= 0x0410 && cp <= 0x042F) {
+    if (koi7) {
+      out[0] = (char)CYRILLIC_KOI7[cp - 0x0410];
+      return 1;
+    }
+    return copyMapping(CYRILLIC_TRANSLIT[cp - 0x0410], lower, out);
+  }
+
+  const IbisCharMapping *mapping = findMapping(cp);
+  if (!mapping) return -1;
+  return copyMapping(koi7 ? mapping->koi7 : mapping->din66003, lower && !koi7,
+                     out);
+}
@@ -1,129 +1,215 @@
 #include "ibis_protocol.h"
-#include <math.h>
+#include <freertos/task.h>
 
-IbisProtocol::IbisProtocol(HardwareSerial &serial) : _serial(serial) {}
+#define TX_IDLE BIT0
 
-void IbisProtocol::begin() {
+// Characters the UART FIFO holds beyond the driver's TX ring
+#define UART_FIFO_CHARS 128
+
+IbisProtocol::IbisProtocol(UartTransport &uart) : _uart(uart) {}
+
+void IbisProtocol::begin(int8_t rxPin, int8_t txPin) {
   // IBIS standard: 1200 baud, 7 data bits, Even parity, 2 stop bits
-  _serial.begin(1200, SERIAL_7E2);
-  // Wait for serial to be ready (blocking for a moment, usually fast on ESP32)
-  unsigned long start = millis();
-  while (!_serial && (millis() - start < 1000))
-    ;
-}
+  if (!_uart.begin(1200, SERIAL_7E2, rxPin, txPin)) {
+    Serial.println("IBIS: failed to set up the UART");
+    return;
+  }
 
-void IbisProtocol::setLine(uint16_t line) {
-  sendTelegram("l" + padNumber(line, 3));
+  if (_txQueue) return;
+  _txQueue = xQueueCreate(IBIS_TX_QUEUE_LENGTH, sizeof(TxChunk));
+  _enqueueLock = xSemaphoreCreateMutex();
+  _pendingLock = xSemaphoreCreateMutex();
+  _txEvents = xEventGroupCreate();
+  if (!_txQueue || !_enqueueLock || !_pendingLock || !_txEvents) {
+    Serial.println("IBIS: failed to create TX queue");
+    return;
+  }
+  xEventGroupSetBits(_txEvents, TX_IDLE);
+  xTaskCreatePinnedToCore(txTask, "ibis_tx", 3072, this, 3, nullptr,
+                          ARDUINO_RUNNING_CORE ? 0 : 1);
 }
 
-void IbisProtocol::setDestination(uint16_t dest) {
-  sendTelegram("z" + padNumber(dest, 3));
+void IbisProtocol::setInterTelegramGap(uint16_t ms) {
+  _gapMs = ms;
 }
 
-void IbisProtocol::setCycle(uint8_t cycle) {
-  sendTelegram("xC" + String(cycle));
+bool IbisProtocol::waitIdle(uint32_t timeoutMs) {
+  if (!_txEvents) return true;
+  return xEventGroupWaitBits(_txEvents, TX_IDLE, pdFALSE, pdTRUE,
+                             pdMS_TO_TICKS(timeoutMs)) &
+         TX_IDLE;
 }
 
-void IbisProtocol::setTime(String hhmm) {
-  sendTelegram("u" + hhmm);
+void IbisProtocol::setCodePage(IbisCodePage page, char fallback) {
+  _codePage = page;
+  _fallback = fallback;
 }
 
-void IbisProtocol::setText(String text) {
-  sendTelegram("v" + text);
+IbisTxStats IbisProtocol::stats() {
+  portENTER_CRITICAL(&_mux);
+  IbisTxStats copy = _stats;
+  portEXIT_CRITICAL(&_mux);
+  copy.queueDepth = _txQueue ? uxQueueMessagesWaiting(_txQueue) : 0;
+  return copy;
 }
 
-void IbisProtocol::setComplexText(String text) {
-  // Original implementation: "zM " + text
-  // The previous implementation calculated parity with 0x65 manually,
-  // but sendTelegram handles the generic case correctly if we just pass the
-  // full string. "zM " + text. Parity of "zM " is 0x7A ^ 0x4D ^ 0x20 = 0x17.
-  // 0x72 (default base) ^ 0x17 = 0x65.
-  // So using generic sendTelegram with "zM " + text is mathematically
-  // equivalent to starting with 0x65 and adding text.
-  sendTelegram("zM " + text);
-}
+size_t IbisProtocol::TxStream::write(ByteSpan bytes) {
+  if (!_ibis._txQueue) {
+    // begin() not called yet, send synchronously
+    return _ibis._uart.write(bytes);
+  }
+
+  if (!_open) {
+    xSemaphoreTake(_ibis._pendingLock, portMAX_DELAY);
+    _ibis._pending++;
+    xEventGroupClearBits(_ibis._txEvents, TX_IDLE);
+    xSemaphoreGive(_ibis._pendingLock);
+
+    // Chunks of one telegram must not interleave with another sender's
+    xSemaphoreTake(_ibis._enqueueLock, portMAX_DELAY);
+    _open = true;
+    _chunk.queuedAt = millis();
+    _chunk.len = 0;
+    _chunk.first = true;
+    _chunk.last = false;
+  }
 
-void IbisProtocol::setSymbol(String number) {
-  sendTelegram("lE0" + number);
+  const uint8_t *data = bytes.data;
+  size_t len = bytes.size;
+  while (len > 0) {
+    // A full chunk is only queued once more data follows, so the last one
+    // can still be flagged in flush()
+    if (_chunk.len == IBIS_TX_CHUNK) {
+      xQueueSend(_ibis._txQueue, &_chunk, portMAX_DELAY);
+      _chunk.first = false;
+      _chunk.len = 0;
+    }
+    size_t n = min((size_t)(IBIS_TX_CHUNK - _chunk.len), len);
+    memcpy(_chunk.data + _chunk.len, data, n);
+    _chunk.len += n;
+    data += n;
+    len -= n;
+  }
+  return bytes.size;
 }
 
-void IbisProtocol::setDS021t(String address, String text) {
-  String telegram;
-  // Calculate number of blocks (16 chars per block)
-  byte numBlocks = ceil(text.length() / 16.0);
+void IbisProtocol::TxStream::flush() {
+  if (!_open) return;
+  _chunk.last = true;
+  xQueueSend(_ibis._txQueue, &_chunk, portMAX_DELAY);
+  xSemaphoreGive(_ibis._enqueueLock);
+  _open = false;
+}
 
-  telegram = "aA";
-  telegram += address;
-  telegram += vdvHex(numBlocks);
-  telegram += "A0";  // Attribute?
+void IbisProtocol::txTask(void *arg) {
+  IbisProtocol *ibis = (IbisProtocol *)arg;
+  TxChunk chunk;
+  uint32_t lastEnd = 0;
+  bool sentAny = false;
 
-  // Formatting: ensure double newlines if newline exists, or append double
-  // newline? Following original logic:
-  if (text.indexOf('\n') > 0) {
-    text += "\n";
-  }
-  text += "\n\n";
+  while (true) {
+    if (xQueueReceive(ibis->_txQueue, &chunk, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
 
-  telegram += text;
+    // The gap is measured from the last stop bit of the previous telegram
+    if (chunk.first && sentAny) {
+      uint32_t since = ibis->_uart.now() - lastEnd;
+      if (since < ibis->_gapMs) vTaskDelay(pdMS_TO_TICKS(ibis->_gapMs - since));
+    }
 
-  // Padding the last block to 16 bytes
-  byte remainder = text.length() % 16;
-  if (remainder > 0) {
-    for (byte i = 16; i > remainder; i--) {
-      telegram += " ";
+    ibis->_uart.write(ByteSpan{chunk.data, chunk.len});
+    if (!chunk.last) continue;
+
+    bool done = ibis->waitTxDone();
+    lastEnd = ibis->_uart.now();
+    sentAny = true;
+
+    uint32_t latency = lastEnd - chunk.queuedAt;
+    portENTER_CRITICAL(&ibis->_mux);
+    if (done) {
+      ibis->_stats.sent++;
+      ibis->_stats.lastLatencyMs = latency;
+      if (latency > ibis->_stats.maxLatencyMs)
+        ibis->_stats.maxLatencyMs = latency;
+    } else {
+      ibis->_stats.timeouts++;
+    }
+    portEXIT_CRITICAL(&ibis->_mux);
+    if (!done) {
+      Serial.printf("IBIS: TX done timed out after %u ms\n",
+                    (unsigned)latency);
     }
+
+    xSemaphoreTake(ibis->_pendingLock, portMAX_DELAY);
+    if (--ibis->_pending == 0) xEventGroupSetBits(ibis->_txEvents, TX_IDLE);
+    xSemaphoreGive(ibis->_pendingLock);
   }
+}
 
-  sendTelegram(telegram);
+bool IbisProtocol::waitTxDone() {
+  // Returns on the UART's TX done interrupt, i.e. after the airtime of the
+  // whole telegram (~9.2 ms per character at 1200 7E2). A DS021t telegram
+  // of 255 blocks is on the wire for ~37 s, so each wait is sized from what
+  // is still queued and repeated for as long as the ring keeps draining.
+  size_t pending = _uart.txPending();
+  while (true) {
+    uint32_t ms = (pending + UART_FIFO_CHARS) * IBIS_CHAR_TIME_US / 1000 + 100;
+    if (_uart.waitTxDone(ms)) return true;
+    size_t left = _uart.txPending();
+    if (left == 0 || left >= pending) return false;
+    pending = left;
+  }
 }
 
-void IbisProtocol::sendTelegram(String telegram) {
-  // Optional: processSpecialCharacters(&telegram);
+size_t IbisProtocol::logDropped(size_t bytes) {
+  if (bytes == 0) Serial.println("IBIS telegram too long, not sent");
+  return bytes;
+}
 
-  _serial.print(telegram);
-  _serial.write(0x0D);  // CR
-  _serial.write(calculateParity(telegram));
+size_t IbisProtocol::sendRaw(const uint8_t *frame, size_t len) {
+  TxStream stream(*this);
+  return logDropped(encoder(stream).raw(frame, len));
 }
 
-unsigned char IbisProtocol::calculateParity(const String &text,
-                                            unsigned char startChecksum) {
-  // IBIS Checksum: Inverse (0x7F) XOR with all bytes including CR (0x0D)
-  // 0x7F ^ 0x0D = 0x72. So we start with 0x72 and XOR all data bytes.
-  for (unsigned int i = 0; i < text.length(); i++) {
-    startChecksum ^= (unsigned char)text[i];
-  }
-  return startChecksum;
+size_t IbisProtocol::setLine(uint16_t line) {
+  TxStream stream(*this);
+  return logDropped(encoder(stream).line(line));
 }
 
-String IbisProtocol::padNumber(uint16_t num, uint8_t digits) {
-  String s = String(num);
-  while (s.length() < digits) {
-    s = "0" + s;
-  }
-  return s;
+size_t IbisProtocol::setDestination(uint16_t dest) {
+  TxStream stream(*this);
+  return logDropped(encoder(stream).destination(dest));
 }
 
-String IbisProtocol::vdvHex(byte value) {
-  // VDV usually maps 0-15 to 0-9 and :;<=>?
-  String vdvHexCharacters = "0123456789:;<=>?";
-  String vdvHexValue = "";
-  byte highNibble = value >> 4;
-  byte lowNibble = value & 15;
+size_t IbisProtocol::setCycle(uint8_t cycle) {
+  TxStream stream(*this);
+  return logDropped(encoder(stream).cycle(cycle));
+}
 
-  if (highNibble > 0) {
-    vdvHexValue += vdvHexCharacters.charAt(highNibble);
-  }
-  vdvHexValue += vdvHexCharacters.charAt(lowNibble);
-  return vdvHexValue;
-}
-
-void IbisProtocol::processSpecialCharacters(String *telegram) {
-  if (!telegram) return;
-  telegram->replace("ä", "{");
-  telegram->replace("ö", "|");
-  telegram->replace("ü", "}");
-  telegram->replace("ß", "~");
-  telegram->replace("Ä", "[");
-  telegram->replace("Ö", "\\");
-  telegram->replace("Ü", "]");
+size_t IbisProtocol::setTime(const char *hhmm) {
+  TxStream stream(*this);
+  return logDropped(encoder(stream).time(hhmm));
+}
+
+size_t IbisProtocol::setText(const char *text) {
+  TxStream stream(*this);
+  return logDropped(encoder(stream).text(text));
+}
+
+size_t IbisProtocol::setComplexText(const char *text) {
+  TxStream stream(*this);
+  return logDropped(encoder(stream).complexText(text));
+}
+
+size_t IbisProtocol::setSymbol(const char *number) {
+  TxStream stream(*this);
+  return logDropped(encoder(stream).symbol(number));
+}
+
+size_t IbisProtocol::setDS021t(const char *address, const char *text) {
+  // Blocks go to the TX queue as they are encoded, there is no buffer for
+  // the whole telegram
+  TxStream stream(*this);
+  return logDropped(encoder(stream).ds021t(address, text));
 }
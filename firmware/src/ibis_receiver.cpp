@@ -0,0 +1,193 @@
+#include "ibis_receiver.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+bool IbisParser::feed(uint8_t byte, Telegram &out) {
+  byte &= 0x7F;  // 7E2: the UART may hand over the parity bit
+
+  switch (_state) {
+  case CONTENT:
+    if (byte == 0x0D) {
+      _state = PARITY;
+    } else if (_len < IBIS_RX_MAX) {
+      _buf[_len++] = byte;
+      _parity ^= byte;
+    } else {
+      _overflows++;
+      _state = SKIP;
+    }
+    return false;
+
+  case PARITY: {
+    bool ok = (byte == _parity) && _len > 0;
+    if (!ok && _len > 0) _parityErrors++;
+    if (ok) {
+      _buf[_len] = '\0';
+      decode(out);
+    }
+    _state = CONTENT;
+    _len = 0;
+    _parity = IBIS_PARITY_SEED;
+    return ok;
+  }
+
+  case SKIP:
+    if (byte == 0x0D) _state = SKIP_PARITY;
+    return false;
+
+  case SKIP_PARITY:
+  default:
+    _state = CONTENT;
+    _len = 0;
+    _parity = IBIS_PARITY_SEED;
+    return false;
+  }
+}
+
+bool IbisParser::parseNumber(size_t start, uint16_t &value) const {
+  if (start >= _len) return false;
+  uint32_t result = 0;
+  for (size_t i = start; i < _len; i++) {
+    if (_buf[i] < '0' || _buf[i] > '9') return false;
+    result = result * 10 + (_buf[i] - '0');
+    if (result > UINT16_MAX) return false;
+  }
+  value = result;
+  return true;
+}
+
+void IbisParser::decode(Telegram &out) {
+  out.type = OTHER;
+  out.number = 0;
+  out.text = _buf;
+
+  switch (_buf[0]) {
+  case 'l':
+    if (parseNumber(1, out.number)) out.type = LINE;
+    break;
+  case 'z':
+    if (_len >= 3 && _buf[1] == 'M' && _buf[2] == ' ') {
+      out.type = COMPLEX_TEXT;
+      out.text = _buf + 3;
+    } else if (parseNumber(1, out.number)) {
+      out.type = DESTINATION;
+    }
+    break;
+  case 'u':
+    if (parseNumber(1, out.number)) out.type = TIME;
+    break;
+  case 'v':
+    out.type = TEXT;
+    out.text = _buf + 1;
+    break;
+  default:
+    break;
+  }
+}
+
+static inline uint32_t pairKey(uint16_t line, uint16_t dest) {
+  return ((uint32_t)line << 16) | dest;
+}
+
+static inline size_t pairHash(uint32_t key, uint8_t shift) {
+  // Fibonacci hashing: the top bits of the product index a table of
+  // 2^(32 - shift) slots
+  return (uint32_t)(key * 2654435769u) >> shift;
+}
+
+void IbisRouteIndex::build(const IndexData &index) {
+  size_t count = index.buses.size() + index.trams.size();
+  size_t size = 16;
+  _shift = 28;
+  while (size < count * 2) {
+    size <<= 1;
+    _shift--;
+  }
+  _slots.assign(size, Slot{0, nullptr});
+
+  size_t mask = size - 1;
+  for (const std::vector<RouteEntry> *list : {&index.buses, &index.trams}) {
+    for (const RouteEntry &entry : *list) {
+      uint32_t key = pairKey(entry.ibisLine, entry.ibisDestination);
+      for (size_t i = pairHash(key, _shift);; i = (i + 1) & mask) {
+        if (!_slots[i].entry) {
+          _slots[i] = {key, &entry};
+          break;
+        }
+        if (_slots[i].key == key) break;  // keep the first match
+      }
+    }
+  }
+}
+
+const RouteEntry *IbisRouteIndex::find(uint16_t line, uint16_t dest) const {
+  if (_slots.empty()) return nullptr;
+  uint32_t key = pairKey(line, dest);
+  size_t mask = _slots.size() - 1;
+  for (size_t i = pairHash(key, _shift); _slots[i].entry;
+       i = (i + 1) & mask) {
+    if (_slots[i].key == key) return _slots[i].entry;
+  }
+  return nullptr;
+}
+
+IbisReceiver::IbisReceiver(UartTransport &uart, const IndexData &index)
+    : _uart(uart), _index(index) {}
+
+bool IbisReceiver::begin(RouteCallback callback, void *ctx) {
+  _callback = callback;
+  _callbackCtx = ctx;
+  _routes.build(_index);
+  return xTaskCreatePinnedToCore(task, "ibis_rx", 3072, this, 2, nullptr,
+                                 ARDUINO_RUNNING_CORE ? 0 : 1) == pdPASS;
+}
+
+void IbisReceiver::handle(const IbisParser::Telegram &telegram) {
+  _telegrams++;
+  switch (telegram.type) {
+  case IbisParser::LINE:
+    if (telegram.number == _line) return;
+    _line = telegram.number;
+    break;
+  case IbisParser::DESTINATION:
+    if (telegram.number == _dest) return;
+    _dest = telegram.number;
+    break;
+  default:
+    return;
+  }
+  _changedAt = millis();
+  _resolved = false;
+}
+
+void IbisReceiver::resolve() {
+  _resolved = true;
+  if (_line < 0 || _dest < 0) return;
+
+  const RouteEntry *entry = _routes.find(_line, _dest);
+  if (!entry) {
+    Serial.printf("IBIS RX: no route for line %d, destination %d\n",
+                  (int)_line, (int)_dest);
+    return;
+  }
+  Serial.printf("IBIS RX: line %d, destination %d -> %s\n", (int)_line,
+                (int)_dest, _index.name(*entry));
+  if (_callback) _callback(entry, _callbackCtx);
+}
+
+void IbisReceiver::task(void *arg) {
+  IbisReceiver *rx = (IbisReceiver *)arg;
+  IbisParser::Telegram telegram;
+  uint8_t buf[32];
+
+  while (true) {
+    // Wakes on data or every 50 ms to check the settle time
+    size_t len = rx->_uart.read(buf, sizeof(buf), 50);
+    for (size_t i = 0; i < len; i++) {
+      if (rx->_parser.feed(buf[i], telegram)) rx->handle(telegram);
+    }
+    if (!rx->_resolved && millis() - rx->_changedAt >= IBIS_RX_SETTLE_MS) {
+      rx->resolve();
+    }
+  }
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+#include "file_manager.h"
+#include "ibis_telegram.h"
+#include "uart_transport.h"
+
+#ifndef IBIS_RX_MAX
+#define IBIS_RX_MAX 128
+#endif
+
+// Quiet time after the last line/destination telegram before the pair is
+// resolved, so a new line is not matched against the old destination
+#ifndef IBIS_RX_SETTLE_MS
+#define IBIS_RX_SETTLE_MS 300
+#endif
+
+/**
+ * @brief Incremental IBIS telegram parser, one byte at a time
+ *
+ * Collects content up to CR, then checks the parity byte that follows
+ * against the running XOR. Works in a fixed buffer; overlong telegrams are
+ * skipped up to the next CR.
+ */
+class IbisParser {
+public:
+  enum Type : uint8_t {
+    LINE,          // l001
+    DESTINATION,   // z001
+    TIME,          // u1234
+    TEXT,          // vText
+    COMPLEX_TEXT,  // zM Text
+    OTHER,
+  };
+
+  struct Telegram {
+    Type type;
+    uint16_t number;   // LINE, DESTINATION, TIME
+    const char *text;  // TEXT, COMPLEX_TEXT (valid until the next feed)
+  };
+
+  /**
+   * @return true when `out` holds a complete telegram with valid parity
+   */
+  bool feed(uint8_t byte, Telegram &out);
+
+  uint32_t parityErrors() const { return _parityErrors; }
+  uint32_t overflows() const { return _overflows; }
+
+private:
+  enum State : uint8_t { CONTENT, PARITY, SKIP, SKIP_PARITY };
+
+  State _state = CONTENT;
+  char _buf[IBIS_RX_MAX + 1];
+  size_t _len = 0;
+  uint8_t _parity = IBIS_PARITY_SEED;
+  uint32_t _parityErrors = 0;
+  uint32_t _overflows = 0;
+
+  void decode(Telegram &out);
+  bool parseNumber(size_t start, uint16_t &value) const;
+};
+
+/**
+ * @brief Hash table from (line, destination) to a route in IndexData
+ */
+class IbisRouteIndex {
+public:
+  void build(const IndexData &index);
+
+  /**
+   * @return The first route with this pair (buses before trams), or nullptr
+   */
+  const RouteEntry *find(uint16_t line, uint16_t dest) const;
+
+private:
+  struct Slot {
+    uint32_t key;
+    const RouteEntry *entry;
+  };
+  std::vector<Slot> _slots;
+  uint8_t _shift = 32;  // 32 - log2(_slots.size())
+};
+
+/**
+ * @brief IBIS slave: listens to the vehicle's master and follows its route
+ *
+ * Decoded line/destination pairs are resolved through IbisRouteIndex and
+ * handed to the callback, which runs on the receiver task.
+ */
+class IbisReceiver {
+public:
+  typedef void (*RouteCallback)(const RouteEntry *entry, void *ctx);
+
+  IbisReceiver(UartTransport &uart, const IndexData &index);
+
+  bool begin(RouteCallback callback, void *ctx);
+
+  uint32_t telegrams() const { return _telegrams; }
+  const IbisParser &parser() const { return _parser; }
+
+private:
+  UartTransport &_uart;
+  const IndexData &_index;
+  IbisParser _parser;
+  IbisRouteIndex _routes;
+  RouteCallback _callback = nullptr;
+  void *_callbackCtx = nullptr;
+
+  uint32_t _telegrams = 0;
+  int32_t _line = -1;
+  int32_t _dest = -1;
+  uint32_t _changedAt = 0;
+  bool _resolved = true;
+
+  void handle(const IbisParser::Telegram &telegram);
+  void resolve();
+  static void task(void *arg);
+};
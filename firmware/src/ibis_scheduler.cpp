@@ -0,0 +1,256 @@
+#include "ibis_scheduler.h"
+
+#define URGENT_IDLE BIT0
+
+// Credit the bucket can hold: enough for a couple of long text telegrams
+#define MAX_CREDIT_US (2 * 1000000L)
+#define WINDOW_MS 10000
+
+IbisScheduler::IbisScheduler(IbisProtocol &ibis) : _ibis(ibis) {
+  _items[LINE].period = 10000;
+  _items[DESTINATION].period = 10000;
+  _items[TIME].period = 30000;
+  _items[TEXT].period = 30000;
+}
+
+bool IbisScheduler::begin() {
+  _lock = xSemaphoreCreateMutex();
+  _events = xEventGroupCreate();
+  if (!_lock || !_events) return false;
+  xEventGroupSetBits(_events, URGENT_IDLE);
+
+  _lastRefill = millis();
+  _windowStart = _lastRefill;
+  return xTaskCreatePinnedToCore(task, "ibis_sched", 3072, this, 2, &_task,
+                                 ARDUINO_RUNNING_CORE ? 0 : 1) == pdPASS;
+}
+
+void IbisScheduler::setLine(uint16_t line) {
+  setNumber(LINE, line);
+}
+
+void IbisScheduler::setDestination(uint16_t dest) {
+  setNumber(DESTINATION, dest);
+}
+
+void IbisScheduler::setTime(const char *hhmm) {
+  setString(TIME, hhmm);
+}
+
+void IbisScheduler::setText(const char *text) {
+  setString(TEXT, text);
+}
+
+void IbisScheduler::markDirty(State &state) {
+  // A change still waiting to go out is superseded, not sent twice
+  if (state.dirty) _stats.coalesced++;
+  state.valid = true;
+  state.dirty = true;
+  xEventGroupClearBits(_events, URGENT_IDLE);
+}
+
+void IbisScheduler::setNumber(Item item, uint16_t value) {
+  if (_listenOnly) return;
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  State &state = _items[item];
+  if (state.valid && state.frameLen == 0 && state.number == value) {
+    _stats.coalesced++;
+  } else {
+    markDirty(state);
+    state.number = value;
+    state.frameLen = 0;
+  }
+  xSemaphoreGive(_lock);
+  if (_task) xTaskNotifyGive(_task);
+}
+
+void IbisScheduler::setString(Item item, const char *value) {
+  if (_listenOnly) return;
+  size_t len = strlen(value);
+  if (len >= sizeof(State::text)) {
+    Serial.printf("IBIS scheduler: %u byte text too long, ignored\n",
+                  (unsigned)len);
+    return;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  State &state = _items[item];
+  if (state.valid && state.frameLen == 0 &&
+      strncmp(state.text, value, sizeof(state.text)) == 0) {
+    _stats.coalesced++;
+  } else {
+    markDirty(state);
+    memcpy(state.text, value, len + 1);
+    state.frameLen = 0;
+  }
+  xSemaphoreGive(_lock);
+  if (_task) xTaskNotifyGive(_task);
+}
+
+void IbisScheduler::setFrame(Item item, const uint8_t *frame, size_t len) {
+  if (_listenOnly || len == 0) return;
+  if (len > sizeof(State::text)) {
+    Serial.printf("IBIS scheduler: %u byte frame too long, ignored\n",
+                  (unsigned)len);
+    return;
+  }
+
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  State &state = _items[item];
+  if (state.valid && state.frameLen == len &&
+      memcmp(state.text, frame, len) == 0) {
+    _stats.coalesced++;
+  } else {
+    markDirty(state);
+    memcpy(state.text, frame, len);
+    state.frameLen = len;
+  }
+  xSemaphoreGive(_lock);
+  if (_task) xTaskNotifyGive(_task);
+}
+
+void IbisScheduler::setPeriod(Item item, uint32_t ms) {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _items[item].period = ms;
+  xSemaphoreGive(_lock);
+}
+
+void IbisScheduler::setBusBudget(uint8_t percent) {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _budgetPercent = constrain(percent, 1, 100);
+  xSemaphoreGive(_lock);
+}
+
+void IbisScheduler::setListenOnly(bool listenOnly) {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  _listenOnly = listenOnly;
+  if (listenOnly) {
+    for (State &state : _items) {
+      state.valid = false;
+      state.dirty = false;
+    }
+    xEventGroupSetBits(_events, URGENT_IDLE);
+  }
+  xSemaphoreGive(_lock);
+}
+
+bool IbisScheduler::waitSent(uint32_t timeoutMs) {
+  uint32_t start = millis();
+  if (!(xEventGroupWaitBits(_events, URGENT_IDLE, pdFALSE, pdTRUE,
+                            pdMS_TO_TICKS(timeoutMs)) &
+        URGENT_IDLE)) {
+    return false;
+  }
+  uint32_t elapsed = millis() - start;
+  return _ibis.waitIdle(elapsed < timeoutMs ? timeoutMs - elapsed : 0);
+}
+
+IbisBusStats IbisScheduler::stats() {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  IbisBusStats copy = _stats;
+  xSemaphoreGive(_lock);
+  return copy;
+}
+
+size_t IbisScheduler::send(Item item, const State &snapshot) {
+  if (snapshot.frameLen) {
+    return _ibis.sendRaw((const uint8_t *)snapshot.text, snapshot.frameLen);
+  }
+  switch (item) {
+  case LINE:
+    return _ibis.setLine(snapshot.number);
+  case DESTINATION:
+    return _ibis.setDestination(snapshot.number);
+  case TIME:
+    return _ibis.setTime(snapshot.text);
+  case TEXT:
+    return _ibis.setText(snapshot.text);
+  default:
+    return 0;
+  }
+}
+
+void IbisScheduler::charge(size_t frameBytes) {
+  uint32_t airtime = frameBytes * IBIS_CHAR_TIME_US;
+  _creditUs -= airtime;
+  _windowAirtimeUs += airtime;
+}
+
+void IbisScheduler::tick() {
+  uint32_t now = millis();
+
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  if (_listenOnly) {
+    xSemaphoreGive(_lock);
+    return;
+  }
+
+  // Refill: budget% of every elapsed millisecond is available as airtime
+  uint32_t elapsed = now - _lastRefill;
+  _lastRefill = now;
+  _creditUs = min((int32_t)MAX_CREDIT_US,
+                  _creditUs + (int32_t)(elapsed * 10 * _budgetPercent));
+
+  if (now - _windowStart >= WINDOW_MS) {
+    _stats.utilisation =
+        _windowAirtimeUs / 10 / max((uint32_t)1, now - _windowStart);
+    _windowStart = now;
+    _windowAirtimeUs = 0;
+  }
+
+  // Changes first, in item order
+  for (uint8_t i = 0; i < ITEM_COUNT; i++) {
+    State &state = _items[i];
+    if (!state.dirty) continue;
+    State snapshot = state;
+    state.dirty = false;
+    state.lastSent = now;
+    xSemaphoreGive(_lock);
+    size_t bytes = send((Item)i, snapshot);
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    charge(bytes);
+    _stats.urgentSent++;
+  }
+
+  bool anyDirty = false;
+  for (const State &state : _items) anyDirty |= state.dirty;
+  if (!anyDirty) xEventGroupSetBits(_events, URGENT_IDLE);
+
+  // One refresh per tick, the most overdue one, and only onto an empty TX
+  // queue so a change arriving next never waits behind a refresh backlog
+  int best = -1;
+  uint32_t bestOverdue = 0;
+  for (uint8_t i = 0; i < ITEM_COUNT; i++) {
+    const State &state = _items[i];
+    if (!state.valid || state.period == 0) continue;
+    uint32_t age = now - state.lastSent;
+    if (age >= state.period && (best < 0 || age - state.period > bestOverdue)) {
+      best = i;
+      bestOverdue = age - state.period;
+    }
+  }
+
+  if (best >= 0 && _ibis.stats().queueDepth == 0) {
+    if (_creditUs <= 0) {
+      _stats.deferred++;
+    } else {
+      State snapshot = _items[best];
+      _items[best].lastSent = now;
+      xSemaphoreGive(_lock);
+      size_t bytes = send((Item)best, snapshot);
+      xSemaphoreTake(_lock, portMAX_DELAY);
+      charge(bytes);
+      _stats.cyclicSent++;
+    }
+  }
+
+  xSemaphoreGive(_lock);
+}
+
+void IbisScheduler::task(void *arg) {
+  IbisScheduler *scheduler = (IbisScheduler *)arg;
+  while (true) {
+    // Woken early by a change, otherwise once per tick for refreshes
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IBIS_SCHEDULER_TICK_MS));
+    scheduler->tick();
+  }
+}
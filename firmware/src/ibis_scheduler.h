@@ -0,0 +1,129 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "ibis_protocol.h"
+
+#ifndef IBIS_SCHEDULER_TICK_MS
+#define IBIS_SCHEDULER_TICK_MS 50
+#endif
+
+// Share of the bus airtime cyclic refreshes may use, in percent
+#ifndef IBIS_BUS_BUDGET_PERCENT
+#define IBIS_BUS_BUDGET_PERCENT 20
+#endif
+
+// A slot holds either UTF-8 text for a full text telegram, at two bytes
+// per character as for Cyrillic, or a precompiled frame
+#define IBIS_SCHEDULER_TEXT_MAX (2 * IBIS_TEXT_MAX + 1)
+static_assert(IBIS_SCHEDULER_TEXT_MAX >= IBIS_TEXT_MAX + 2,
+              "a slot must hold a whole text frame");
+
+struct IbisBusStats {
+  uint32_t urgentSent;   // telegrams sent because the value changed
+  uint32_t cyclicSent;   // periodic refreshes
+  uint32_t coalesced;    // updates dropped as duplicates or superseded
+  uint32_t deferred;     // refresh slots skipped to stay within the budget
+  uint8_t utilisation;   // percent of bus time used over the last window
+};
+
+/**
+ * @brief Keeps IBIS signs in sync by resending the current state
+ *
+ * Signs can lose their content after a power glitch, so line, destination,
+ * time and text are refreshed on their own periods. A change is sent ahead
+ * of any refresh and repeated changes before it goes out are coalesced.
+ * Refreshes only go out while their airtime fits the configured share of
+ * the 1200 baud bus; changes are always sent but are charged to the same
+ * budget.
+ */
+class IbisScheduler {
+public:
+  enum Item : uint8_t { LINE, DESTINATION, TIME, TEXT, ITEM_COUNT };
+
+  IbisScheduler(IbisProtocol &ibis);
+
+  bool begin();
+
+  void setLine(uint16_t line);
+  void setDestination(uint16_t dest);
+  /**
+   * @brief Set a text item; text that does not fit a slot is logged and
+   * ignored, never cut
+   */
+  void setTime(const char *hhmm);
+  void setText(const char *text);
+
+  /**
+   * @brief Set an item from a precompiled telegram (content, CR, parity)
+   *
+   * Sent and refreshed through IbisProtocol::sendRaw, so nothing is encoded
+   * again. Frames longer than IBIS_SCHEDULER_TEXT_MAX are logged and
+   * ignored.
+   */
+  void setFrame(Item item, const uint8_t *frame, size_t len);
+
+  /**
+   * @brief Refresh period of an item, 0 disables the cyclic resend
+   */
+  void setPeriod(Item item, uint32_t ms);
+
+  /**
+   * @brief Share of the bus time refreshes may use (1-100 %)
+   */
+  void setBusBudget(uint8_t percent);
+
+  /**
+   * @brief Another master drives the bus: drop all state and send nothing
+   *
+   * Changes made while listening are ignored and waitSent() returns at
+   * once, so no telegram of ours collides with the master's or is read
+   * back as its traffic. Call after begin().
+   */
+  void setListenOnly(bool listenOnly);
+  bool listenOnly() const { return _listenOnly; }
+
+  /**
+   * @brief Block until all changes are on the wire
+   * @return false on timeout
+   */
+  bool waitSent(uint32_t timeoutMs);
+
+  IbisBusStats stats();
+
+private:
+  struct State {
+    bool valid = false;
+    bool dirty = false;  // changed, needs an urgent send
+    uint32_t period = 0;
+    uint32_t lastSent = 0;
+    uint16_t number = 0;
+    uint16_t frameLen = 0;  // text holds a raw frame when non-zero
+    char text[IBIS_SCHEDULER_TEXT_MAX] = "";
+  };
+
+  IbisProtocol &_ibis;
+  State _items[ITEM_COUNT];
+  SemaphoreHandle_t _lock = nullptr;
+  EventGroupHandle_t _events = nullptr;
+  TaskHandle_t _task = nullptr;
+
+  volatile bool _listenOnly = false;
+  uint8_t _budgetPercent = IBIS_BUS_BUDGET_PERCENT;
+  int32_t _creditUs = 0;  // token bucket of airtime, in microseconds
+  uint32_t _lastRefill = 0;
+
+  IbisBusStats _stats = {};
+  uint32_t _windowStart = 0;
+  uint32_t _windowAirtimeUs = 0;
+
+  void setNumber(Item item, uint16_t value);
+  void setString(Item item, const char *value);
+  void markDirty(State &state);
+  size_t send(Item item, const State &snapshot);
+  void charge(size_t frameBytes);
+  void tick();
+  static void task(void *arg);
+};
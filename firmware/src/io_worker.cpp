@@ -0,0 +1,496 @@
+#include "io_worker.h"
+#include <freertos/task.h>
+#include <esp_heap_caps.h>
+#include <lvgl.h>
+#include "lvgl_v8_port.h"
+#include "mono_pack.h"
+
+IoWorker::IoWorker(RouteCache &routeCache,
+                   IbisScheduler &ibis,
+                   UartTransport &alfa)
+    : _routeCache(routeCache), _ibis(ibis), _alfa(alfa) {}
+
+bool IoWorker::begin(ProgressCallback callback, void *ctx) {
+  _callback = callback;
+  _callbackCtx = ctx;
+  _queue = xQueueCreate(IO_WORKER_QUEUE_LENGTH, sizeof(Job));
+  if (!_queue) return false;
+
+  // LVGL runs on ARDUINO_RUNNING_CORE, the worker takes the other one
+  return xTaskCreatePinnedToCore(task, "io_worker", 6144, this, 2, nullptr,
+                                 ARDUINO_RUNNING_CORE ? 0 : 1) == pdPASS;
+}
+
+bool IoWorker::submitApply(const char *id,
+                           const char *name,
+                           int type,
+                           bool ibis) {
+  if (!_queue) return false;
+  Job job = {id, name, type, ibis};
+  return xQueueSend(_queue, &job, 0) == pdTRUE;
+}
+
+ApplyProgress IoWorker::progress() {
+  portENTER_CRITICAL(&_mux);
+  ApplyProgress copy = _progress;
+  portEXIT_CRITICAL(&_mux);
+  return copy;
+}
+
+void IoWorker::task(void *arg) {
+  IoWorker *worker = (IoWorker *)arg;
+  Job job;
+  while (true) {
+    // A scrolling or paged sign wakes the task for its next frame
+    TickType_t wait = portMAX_DELAY;
+    if (worker->_marquee.active()) {
+      int32_t left = (int32_t)(worker->_nextFrame - millis());
+      wait = left > 0 ? pdMS_TO_TICKS(left) : 0;
+    }
+    if (xQueueReceive(worker->_queue, &job, wait) == pdTRUE) {
+      worker->run(job);
+    } else if (worker->_marquee.active()) {
+      worker->animate();
+    }
+  }
+}
+
+void IoWorker::asyncNotify(void *arg) {
+  IoWorker *worker = (IoWorker *)arg;
+  worker->_notifyPending = false;
+  if (worker->_callback) worker->_callback(worker->_callbackCtx);
+}
+
+void IoWorker::report(ApplyProgress::State state,
+                      uint32_t sent,
+                      uint32_t total) {
+  portENTER_CRITICAL(&_mux);
+  _progress.state = state;
+  _progress.sent = sent;
+  _progress.total = total;
+  portEXIT_CRITICAL(&_mux);
+
+  // Coalesce: the UI reads the latest snapshot, one pending call is enough.
+  // lv_async_call is not thread-safe, so schedule it under the LVGL lock.
+  if (_notifyPending) return;
+  _notifyPending = true;
+  lvgl_port_lock(-1);
+  lv_async_call(asyncNotify, this);
+  lvgl_port_unlock();
+}
+
+void IoWorker::run(const Job &job) {
+  portENTER_CRITICAL(&_mux);
+  _progress = {ApplyProgress::RUNNING, job.ibis, job.name, 0, 0};
+  portEXIT_CRITICAL(&_mux);
+
+  RouteDetails details;
+  if (!_routeCache.get(job.id, job.type, details)) {
+    Serial.println("Failed to read route file");
+    report(ApplyProgress::FAILED, 0, 0);
+    return;
+  }
+
+  Serial.println("Parsing successful. Applying...");
+  bool ok = job.ibis ? sendIbis(details) : sendAlfa(details, job.type);
+  ApplyProgress current = progress();
+  report(ok ? ApplyProgress::DONE : ApplyProgress::FAILED, current.sent,
+         current.total);
+
+  RouteCacheStats stats = _routeCache.stats();
+  Serial.printf("Route cache: %u hits, %u misses, %u evictions\n",
+                (unsigned)stats.hits, (unsigned)stats.misses,
+                (unsigned)stats.evictions);
+}
+
+bool IoWorker::sendIbis(const RouteDetails &details) {
+  if (_ibis.listenOnly()) {
+    Serial.println("IBIS: the bus is driven by the vehicle's master");
+    return false;
+  }
+  Serial.println("Sending IBIS commands...");
+  uint16_t line = details.ibisLine;
+  uint16_t dest = details.ibisDestination;
+
+  // The scheduler sends both ahead of any refresh and keeps resending them.
+  // Catalog routes carry the framed telegrams, which go out unchanged.
+  if (details.ibisFramesLen > 0) {
+    queueIbisFrames(details.ibisFrames, details.ibisFramesLen);
+  } else {
+    _ibis.setLine(line);
+    _ibis.setDestination(dest);
+  }
+  if (!_ibis.waitSent(2000)) {
+    Serial.println("IBIS: timed out waiting for transmission");
+    return false;
+  }
+
+  IbisBusStats stats = _ibis.stats();
+  Serial.printf("IBIS sent: Line %d, Dest %d (bus %u%%)\n", line, dest,
+                (unsigned)stats.utilisation);
+  return true;
+}
+
+void IoWorker::queueIbisFrames(const uint8_t *frames, size_t len) {
+  // Content never contains CR, so the first CR ends a frame and the byte
+  // after it is the parity (which may itself be 0x0D)
+  size_t start = 0;
+  for (size_t i = 0; i + 1 < len; i++) {
+    if (frames[i] != 0x0D) continue;
+    const uint8_t *frame = frames + start;
+    size_t frameLen = i + 2 - start;
+    switch (frame[0]) {
+    case 'l':
+      _ibis.setFrame(IbisScheduler::LINE, frame, frameLen);
+      break;
+    case 'z':
+      _ibis.setFrame(IbisScheduler::DESTINATION, frame, frameLen);
+      break;
+    default:
+      Serial.printf("IBIS: no slot for precompiled telegram '%c'\n", frame[0]);
+      break;
+    }
+    start = i + 2;
+    i++;
+  }
+}
+
+bool IoWorker::cachedCanvas(uint64_t key, FrameBlob &entry) {
+  // Entries hold the canvas, the length of every panel's full update and
+  // then those updates, so a hit needs neither the renderer nor the encoder
+  MonoBitmap &canvas = _layout->canvas();
+  size_t header = canvas.bytes() + _layout->panelCount() * sizeof(uint32_t);
+  if (!_frames || !_frames->get(key, entry) || entry.len < header) {
+    entry = FrameBlob();
+    return false;
+  }
+  memcpy(canvas.data, entry.data.get(), canvas.bytes());
+  return true;
+}
+
+bool IoWorker::showCanvas(uint64_t key, FrameBlob entry, const char *label) {
+  SignLayout &layout = *_layout;
+  size_t count = layout.panelCount();
+  size_t canvasBytes = layout.canvas().bytes();
+  bool cached = entry.len > 0;
+  size_t capacity = entry.len;
+  if (!cached) {
+    capacity = canvasBytes + count * sizeof(uint32_t);
+    for (size_t i = 0; i < count; i++) {
+      capacity += SignLayout::fullBound(layout.panel(i));
+    }
+    entry.data = std::shared_ptr<uint8_t>(
+        (uint8_t *)heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM),
+        heap_caps_free);
+    if (entry.data) {
+      memcpy(entry.data.get(), layout.canvas().data, canvasBytes);
+      entry.len = canvasBytes + count * sizeof(uint32_t);
+    }
+  }
+
+  uint8_t *table = entry.data ? entry.data.get() + canvasBytes : nullptr;
+  // Progress counts bytes sent against the full updates of all panels, or
+  // their bounds before they are encoded; partial updates send less and
+  // are completed by the report after the link is idle
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t len = 0;
+    if (cached) memcpy(&len, table + i * sizeof(len), sizeof(len));
+    total += cached ? len : SignLayout::fullBound(layout.panel(i));
+  }
+
+  size_t offset = canvasBytes + count * sizeof(uint32_t);
+  size_t sent = 0;
+  for (size_t i = 0; i < count; i++) {
+    layout.slice(i);
+    ByteSpan full = {nullptr, 0};
+    uint32_t len = 0;
+    if (cached) {
+      memcpy(&len, table + i * sizeof(len), sizeof(len));
+      if (len > capacity - offset) len = 0;
+      full = {entry.data.get() + offset, len};
+    } else if (entry.data) {
+      len = layout.encodeFull(i, entry.data.get() + offset, capacity - offset);
+      memcpy(table + i * sizeof(len), &len, sizeof(len));
+      full = {entry.data.get() + offset, len};
+      entry.len += len;
+    }
+    offset += len;
+    // The link sends this panel while the next one is sliced and encoded
+    sent += layout.send(i, full);
+    report(ApplyProgress::RUNNING, min(sent, total), total);
+  }
+  if (!cached && entry.data && _frames) _frames->put(key, entry);
+
+  if (!layout.waitSent(10000)) {
+    Serial.println("Alfa: transmission stalled");
+    return false;
+  }
+  report(ApplyProgress::RUNNING, sent, sent);
+
+  Serial.printf("Alfa sent: %u bytes to %u panels for %s%s\n",
+                (unsigned)sent, (unsigned)count, label,
+                cached ? " from cache" : "");
+  return true;
+}
+
+bool IoWorker::sendAlfaText(const RouteDetails &details) {
+  MonoBitmap &canvas = _layout->canvas();
+  uint16_t textWidth = _font->textWidth(details.alfaSignText);
+  if (textWidth > canvas.width && _longText != MARQUEE_CROP) {
+    return sendTextMarquee(details.alfaSignText, textWidth);
+  }
+
+  uint64_t key = _layout->key()
+                     .add("text")
+                     .add(details.alfaSignText)
+                     .add(_font->fingerprint())
+                     .value();
+  FrameBlob entry;
+  if (!cachedCanvas(key, entry)) {
+    Serial.println("Rendering Alfa text...");
+    canvas.clear();
+    // Centred; text wider than the canvas is cut off on the right
+    int x = max(0, (canvas.width - textWidth) / 2);
+    int y = ((int)canvas.height - _font->height()) / 2;
+    _font->drawText(canvas, x, y, details.alfaSignText);
+  }
+  return showCanvas(key, entry, details.alfaSignText);
+}
+
+// Greedy word wrap; a word wider than a page gets a page of its own
+static std::vector<String> splitPages(const LawoFont &font,
+                                      const char *text,
+                                      uint16_t width) {
+  std::vector<String> pages;
+  String page, word;
+  for (const char *p = text;; p++) {
+    if (*p && *p != ' ') {
+      word += *p;
+      continue;
+    }
+    if (word.length()) {
+      String candidate = page.length() ? page + " " + word : word;
+      if (page.length() && font.textWidth(candidate.c_str()) > width) {
+        pages.push_back(page);
+        page = word;
+      } else {
+        page = candidate;
+      }
+      word = "";
+    }
+    if (!*p) break;
+  }
+  if (page.length()) pages.push_back(page);
+  return pages;
+}
+
+bool IoWorker::sendTextMarquee(const char *text, uint16_t textWidth) {
+  // The content is rendered once; frames only copy a window of it
+  MonoBitmap &canvas = _layout->canvas();
+  int y = ((int)canvas.height - _font->height()) / 2;
+  MonoBitmap *strip;
+  if (_longText == MARQUEE_PAGE) {
+    std::vector<String> pages = splitPages(*_font, text, canvas.width);
+    size_t count = min(pages.size(), (size_t)(UINT16_MAX / canvas.width));
+    strip = _marquee.strip(count * canvas.width, canvas.height);
+    for (size_t i = 0; strip && i < count; i++) {
+      // Each page is drawn on the canvas first so it cannot spill over
+      const char *page = pages[i].c_str();
+      canvas.clear();
+      int x = max(0, (canvas.width - _font->textWidth(page)) / 2);
+      _font->drawText(canvas, x, y, page);
+      memcpy(strip->data + i * canvas.bytes(), canvas.data, canvas.bytes());
+    }
+  } else {
+    strip = _marquee.strip(textWidth, canvas.height);
+    if (strip) _font->drawText(*strip, 0, y, text);
+  }
+  if (!strip) {
+    Serial.println("Alfa: no memory for the text strip");
+    return false;
+  }
+  _marquee.start(_longText, canvas.width);
+  return startMarquee(text);
+}
+
+bool IoWorker::startMarquee(const char *label) {
+  size_t sent = animate();
+  report(ApplyProgress::RUNNING, sent, sent);
+  Serial.printf("Alfa %s: %s, %u bytes per frame at most every %u ms\n",
+                _marquee.active() ? "animating" : "sent", label,
+                (unsigned)sent, (unsigned)_marquee.interval());
+  return true;
+}
+
+size_t IoWorker::animate() {
+  // One frame at a time: the next is drawn only once this one is on the
+  // wire, so the bus sets the frame rate and the link queue never backs
+  // up. LED panels that did not change are skipped.
+  uint32_t start = millis();
+  _marquee.frame(_layout->canvas());
+  size_t sent = 0;
+  for (size_t i = 0; i < _layout->panelCount(); i++) {
+    _layout->slice(i);
+    sent += _layout->send(i);
+  }
+  if (!_layout->waitSent(10000)) {
+    Serial.println("Alfa: transmission stalled");
+  }
+
+  // Leave the rest of the bus time to other traffic
+  uint32_t busy = millis() - start;
+  _nextFrame =
+      start + max(_marquee.interval(), busy * 100 / MARQUEE_BUS_SHARE);
+  return sent;
+}
+
+bool IoWorker::sendAlfaAsset(const String &path) {
+  // Assets only change when the filesystem image is flashed, which also
+  // empties the cache, so the path is key enough
+  uint64_t key = _layout->key().add("asset").add(path.c_str()).value();
+  FrameBlob entry;
+  if (cachedCanvas(key, entry)) return showCanvas(key, entry, path.c_str());
+
+  FrameBlob file;
+  if (!readAlfaFile(path, file)) return false;
+  MonoBitmap &canvas = _layout->canvas();
+  SignAssetEntry asset;
+  if (signAssetFind(file.data.get(), file.len, canvas.width, canvas.height,
+                    asset)) {
+    if (!decodeAsset(file, asset, canvas, path)) return false;
+    return showCanvas(key, entry, path.c_str());
+  }
+
+  // Content wider than the sign is exported as a strip of its height,
+  // which scrolls unless long content is cropped
+  if (signAssetFind(file.data.get(), file.len, canvas.width, canvas.height,
+                    asset, true)) {
+    MonoBitmap *strip = _marquee.strip(asset.width, asset.height);
+    if (!strip || !decodeAsset(file, asset, *strip, path)) return false;
+    _marquee.start(_longText == MARQUEE_CROP ? MARQUEE_CROP : MARQUEE_SCROLL,
+                   canvas.width);
+    return startMarquee(path.c_str());
+  }
+
+  Serial.printf("Alfa: no %ux%u image in %s\n", canvas.width, canvas.height,
+                path.c_str());
+  return false;
+}
+
+bool IoWorker::decodeAsset(const FrameBlob &file,
+                           const SignAssetEntry &asset,
+                           MonoBitmap &dst,
+                           const String &path) {
+  // Rows are expanded in full, then turned into columns 8x8 at a time
+  size_t stride = (dst.width + 7) / 8;
+  size_t rowsLen = stride * dst.height;
+  uint8_t *rows = (uint8_t *)heap_caps_malloc(rowsLen, MALLOC_CAP_SPIRAM);
+  if (!rows) rows = (uint8_t *)heap_caps_malloc(rowsLen, MALLOC_CAP_DEFAULT);
+  if (!rows) {
+    Serial.printf("Alfa: no memory for %u bytes\n", (unsigned)rowsLen);
+    return false;
+  }
+  bool ok = packBitsDecode(file.data.get() + asset.offset, asset.length, rows,
+                           rowsLen);
+  if (ok) {
+    monoFromRows(rows, stride, dst);
+  } else {
+    Serial.printf("Alfa: corrupt image in %s\n", path.c_str());
+  }
+  heap_caps_free(rows);
+  return ok;
+}
+
+bool IoWorker::readAlfaFile(const String &path, FrameBlob &blob) {
+  if (!LittleFS.exists(path)) {
+    Serial.printf("Sign file not found: %s\n", path.c_str());
+    return false;
+  }
+
+  File binFile = LittleFS.open(path, "r");
+  if (!binFile) {
+    Serial.printf("Failed to open sign file: %s\n", path.c_str());
+    return false;
+  }
+
+  size_t total = binFile.size();
+  uint8_t *data = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_SPIRAM);
+  if (!data) data = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_DEFAULT);
+  if (!data) {
+    Serial.printf("Alfa: no memory for %u bytes\n", (unsigned)total);
+    return false;
+  }
+  blob.data = std::shared_ptr<uint8_t>(data, heap_caps_free);
+  blob.len = total;
+  size_t got = binFile.read(data, total);
+  binFile.close();
+  if (got != total) {
+    Serial.printf("Alfa: short read of %s\n", path.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool IoWorker::sendAlfa(const RouteDetails &details, int type) {
+  _marquee.stop();
+  String path =
+      String(type == 1 ? "/trams/" : "/buses/") + details.alfaSignBinFile;
+  if (_layout && _font && details.alfaSignText[0]) {
+    return sendAlfaText(details);
+  }
+  if (path.endsWith(SIGN_ASSET_EXTENSION)) {
+    if (!_layout) {
+      Serial.println("Alfa: no sign layout for bitmap assets");
+      return false;
+    }
+    return sendAlfaAsset(path);
+  }
+
+  Serial.println("Sending Alfa Binary...");
+  // The .bin files only change when the filesystem image is flashed, which
+  // also empties the cache, so the path is key enough
+  uint64_t key = FrameKey().add("bin").add(path.c_str()).value();
+  FrameBlob blob;
+  bool cached = _frames && _frames->get(key, blob);
+  if (!cached) {
+    if (!readAlfaFile(path, blob)) return false;
+    // Kept in PSRAM only, the file itself is the copy on flash
+    if (_frames) _frames->put(key, blob, false);
+  }
+  const uint8_t *data = blob.data.get();
+  uint32_t total = blob.len;
+
+  // The replayed frames draw over whatever the shadows describe, and must
+  // not interleave with frames still queued on the link
+  if (_layout) {
+    _layout->waitSent(10000);
+    _layout->invalidate();
+  }
+
+  // The whole update goes into the TX ring in one call and the driver
+  // drains it from its interrupt handler. Larger files wait for space.
+  if (!_alfa.submit(data, total)) {
+    Serial.println("Alfa: TX ring too small, writing in parts");
+    _alfa.write(data, total);
+  }
+
+  // Progress follows the ring draining; give up if it stops moving
+  size_t lastPending = SIZE_MAX;
+  uint32_t lastMove = millis();
+  while (!_alfa.waitTxDone(100)) {
+    size_t pending = min(_alfa.txPending(), (size_t)total);
+    report(ApplyProgress::RUNNING, total - pending, total);
+    if (pending != lastPending) {
+      lastPending = pending;
+      lastMove = millis();
+    } else if (millis() - lastMove > 2000) {
+      Serial.println("Alfa: transmission stalled");
+      return false;
+    }
+  }
+
+  Serial.printf("Alfa sent: %u bytes from %s%s\n", (unsigned)total,
+                path.c_str(), cached ? " (cached)" : "");
+  return true;
+}
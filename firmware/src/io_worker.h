@@ -0,0 +1,130 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "route_cache.h"
+#include "ibis_scheduler.h"
+#include "uart_transport.h"
+#include "frame_cache.h"
+#include "lawo_font.h"
+#include "sign_asset.h"
+#include "sign_layout.h"
+#include "sign_marquee.h"
+
+#ifndef IO_WORKER_QUEUE_LENGTH
+#define IO_WORKER_QUEUE_LENGTH 4
+#endif
+
+struct ApplyProgress {
+  enum State : uint8_t { IDLE, RUNNING, DONE, FAILED };
+  State state;
+  bool ibis;
+  const char *name;  // route name, points into IndexData::strings
+  uint32_t sent;     // Alfa bytes written so far
+  uint32_t total;    // Alfa payload size, 0 for IBIS
+};
+
+/**
+ * @brief Runs sign updates on a task pinned to the core LVGL does not use
+ *
+ * The UI submits a job and returns at once. Progress and completion are
+ * handed back through lv_async_call, so the callback runs in the LVGL task
+ * and may touch widgets directly.
+ */
+class IoWorker {
+public:
+  typedef void (*ProgressCallback)(void *ctx);
+
+  IoWorker(RouteCache &routeCache, IbisScheduler &ibis, UartTransport &alfa);
+
+  bool begin(ProgressCallback callback, void *ctx);
+
+  /**
+   * @brief Queue a route to be sent to the signs (non-blocking)
+   * @param id,name Must outlive the job (IndexData strings do)
+   * @param type 0 for bus, 1 for tram
+   * @return false if the queue is full
+   */
+  bool submitApply(const char *id, const char *name, int type, bool ibis);
+
+  /**
+   * @brief The MONO panels Alfa routes are framed for (call before begin())
+   *
+   * Bitmap assets (.sbm) and, with a font, the route's alfaSignText are
+   * drawn on the layout's canvas and encoded per panel when sent. Without
+   * a layout only pre-framed .bin files can be replayed.
+   * @param layout Must outlive the worker
+   */
+  void setSignLayout(SignLayout *layout) { _layout = layout; }
+
+  /**
+   * @brief Render alfaSignText with `font` instead of sending the route's
+   * file (call before begin(); font must outlive the worker)
+   */
+  void setFont(const LawoFont *font) { _font = font; }
+
+  /**
+   * @brief How content wider than the canvas is shown (call before begin())
+   *
+   * Scrolling and paging run on the worker task between jobs until the
+   * next Alfa route is applied.
+   */
+  void setLongText(MarqueeMode mode) { _longText = mode; }
+
+  /**
+   * @brief Keep sent Alfa streams in `cache` (call before begin())
+   */
+  void setFrameCache(FrameCache *cache) { _frames = cache; }
+
+  /**
+   * @brief Snapshot of the job currently or last run
+   */
+  ApplyProgress progress();
+
+private:
+  struct Job {
+    const char *id;
+    const char *name;
+    int type;
+    bool ibis;
+  };
+
+  RouteCache &_routeCache;
+  IbisScheduler &_ibis;
+  UartTransport &_alfa;
+
+  const LawoFont *_font = nullptr;
+  SignLayout *_layout = nullptr;
+  SignMarquee _marquee;
+  MarqueeMode _longText = MARQUEE_CROP;
+  uint32_t _nextFrame = 0;
+  FrameCache *_frames = nullptr;
+
+  QueueHandle_t _queue = nullptr;
+  ProgressCallback _callback = nullptr;
+  void *_callbackCtx = nullptr;
+
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  ApplyProgress _progress = {};
+  volatile bool _notifyPending = false;
+
+  static void task(void *arg);
+  static void asyncNotify(void *arg);
+  void run(const Job &job);
+  bool sendIbis(const RouteDetails &details);
+  void queueIbisFrames(const uint8_t *frames, size_t len);
+  bool sendAlfa(const RouteDetails &details, int type);
+  bool sendAlfaText(const RouteDetails &details);
+  bool sendTextMarquee(const char *text, uint16_t textWidth);
+  bool startMarquee(const char *label);
+  size_t animate();
+  bool sendAlfaAsset(const String &path);
+  bool decodeAsset(const FrameBlob &file,
+                   const SignAssetEntry &asset,
+                   MonoBitmap &dst,
+                   const String &path);
+  bool cachedCanvas(uint64_t key, FrameBlob &entry);
+  bool showCanvas(uint64_t key, FrameBlob entry, const char *label);
+  bool readAlfaFile(const String &path, FrameBlob &blob);
+  void report(ApplyProgress::State state, uint32_t sent, uint32_t total);
+};
@@ -0,0 +1,214 @@
+#include "lawo_font.h"
+#include <LittleFS.h>
+#include <esp_heap_caps.h>
+#include "mono_window.h"
+#include "utf8.h"
+
+// File header offsets, see alfa-bus-protocol/lawo_font.py
+#define HDR_GLYPH_HEIGHT 45
+#define HDR_BASELINE 46
+#define HDR_MIN_CHAR 47
+#define HDR_MAX_CHAR 48
+#define HDR_SPACING 52
+#define HDR_NUM_BLOCKS 60
+#define HDR_METADATA 70  // 3 bytes per glyph: width, bit offset (BE)
+
+LawoFont::~LawoFont() {
+  release();
+}
+
+void LawoFont::release() {
+  if (_owned) heap_caps_free(_owned);
+  _owned = nullptr;
+  _data = nullptr;
+}
+
+bool LawoFont::begin(const uint8_t *data, size_t size) {
+  if (data != _owned) release();
+  _data = nullptr;
+  if (size < HDR_METADATA) return false;
+
+  uint8_t height = data[HDR_GLYPH_HEIGHT];
+  uint8_t minChar = data[HDR_MIN_CHAR];
+  uint8_t maxChar = data[HDR_MAX_CHAR];
+  uint16_t rowBytes = data[HDR_NUM_BLOCKS] << 8 | data[HDR_NUM_BLOCKS + 1];
+  if (height == 0 || height > LAWO_FONT_MAX_HEIGHT || minChar > maxChar ||
+      rowBytes == 0) {
+    Serial.println("LawoFont: unsupported header");
+    return false;
+  }
+
+  // Optional extra data (a string) sits between metadata and glyphs
+  size_t pos = HDR_METADATA + 3 * (maxChar - minChar + 1);
+  if (pos + 2 > size) return false;
+  if (data[pos] == 0x00) {
+    pos += 2;
+  } else {
+    size_t end = pos;
+    while (end + 1 < size && !(data[end] == 0x00 && data[end + 1] == 0x00))
+      end++;
+    pos = end + 3;  // string terminator and two zero bytes
+  }
+  if (pos + (size_t)rowBytes * height > size) {
+    Serial.println("LawoFont: glyph data truncated");
+    return false;
+  }
+
+  // Every glyph must lie within a row so drawing needs no checks
+  const uint8_t *metadata = data + HDR_METADATA;
+  for (int c = minChar; c <= maxChar; c++) {
+    const uint8_t *m = metadata + 3 * (c - minChar);
+    uint32_t offset = m[1] << 8 | m[2];
+    if (offset + m[0] > (uint32_t)rowBytes * 8) {
+      Serial.printf("LawoFont: glyph %d out of range\n", c);
+      return false;
+    }
+  }
+
+  _height = height;
+  _baseline = data[HDR_BASELINE];
+  _spacing = data[HDR_SPACING];
+  _minChar = minChar;
+  _maxChar = maxChar;
+  _rowBytes = rowBytes;
+  _metadata = metadata;
+  _glyphs = data + pos;
+  _data = data;
+
+  // Identifies the font in cache keys, whatever file it came from
+  uint32_t hash = 0x811C9DC5;
+  for (size_t i = 0; i < pos + (size_t)rowBytes * height; i++) {
+    hash = (hash ^ data[i]) * 0x01000193;
+  }
+  _fingerprint = hash;
+  return true;
+}
+
+bool LawoFont::load(const char *path) {
+  File file = LittleFS.open(path, "r");
+  if (!file) {
+    Serial.printf("LawoFont: cannot open %s\n", path);
+    return false;
+  }
+  size_t size = file.size();
+  uint8_t *buf = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  if (!buf) buf = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_DEFAULT);
+  if (!buf) {
+    Serial.printf("LawoFont: no memory for %s\n", path);
+    return false;
+  }
+  size_t got = file.read(buf, size);
+  file.close();
+
+  release();
+  _owned = buf;
+  if (got != size || !begin(buf, size)) {
+    Serial.printf("LawoFont: invalid font %s\n", path);
+    release();
+    return false;
+  }
+  return true;
+}
+
+uint8_t LawoFont::glyphWidth(uint8_t code) const {
+  if (!_data || code < _minChar || code > _maxChar) return 0;
+  return _metadata[3 * (code - _minChar)];
+}
+
+uint16_t LawoFont::glyphOffset(uint8_t code) const {
+  const uint8_t *m = _metadata + 3 * (code - _minChar);
+  return m[1] << 8 | m[2];
+}
+
+uint8_t LawoFont::drawGlyph(MonoBitmap &dst, int x, int y, uint8_t code) const {
+  uint8_t width = glyphWidth(code);
+  if (width == 0) return 0;
+  uint32_t offset = glyphOffset(code);
+
+  // Rows are stored MSB-left; gather them into one word per column, 32
+  // columns at a time, visiting only the set pixels
+  uint32_t columns[32];
+  for (uint8_t x0 = 0; x0 < width; x0 += 32) {
+    uint8_t count = min(32, width - x0);
+    if (x + x0 >= dst.width || x + x0 + count <= 0) continue;
+    memset(columns, 0, sizeof(columns));
+
+    const uint8_t *row = _glyphs;
+    for (uint8_t gy = 0; gy < _height; gy++, row += _rowBytes) {
+      uint32_t bits = monoRowBits(row, offset + x0, count);
+      while (bits) {
+        int gx = __builtin_clz(bits);
+        columns[gx] |= 1UL << gy;
+        bits &= ~(0x80000000UL >> gx);
+      }
+    }
+    for (uint8_t gx = 0; gx < count; gx++) {
+      monoOrColumn(dst, x + x0 + gx, y, columns[gx]);
+    }
+  }
+  return width;
+}
+
+uint8_t LawoFont::mapCodepoint(uint32_t cp) const {
+  if (cp < 0x80) return cp;
+
+  if (_codePage == LAWO_CODEPAGE_CP1251) {
+    if (cp >= 0x0410 && cp <= 0x044F) return 0xC0 + (cp - 0x0410);
+    switch (cp) {
+    case 0x0401: return 0xA8;  // Ё
+    case 0x0404: return 0xAA;  // Є
+    case 0x0406: return 0xB2;  // І
+    case 0x0407: return 0xAF;  // Ї
+    case 0x0451: return 0xB8;  // ё
+    case 0x0454: return 0xBA;  // є
+    case 0x0456: return 0xB3;  // і
+    case 0x0457: return 0xBF;  // ї
+    case 0x0490: return 0xA5;  // Ґ
+    case 0x0491: return 0xB4;  // ґ
+    case 0x00A0: return 0xA0;
+    case 0x00AB: return 0xAB;
+    case 0x00BB: return 0xBB;
+    case 0x2116: return 0xB9;  // №
+    }
+  } else if (cp >= 0xA0 && cp <= 0xFF) {
+    return cp;  // Latin-1 part of cp1252
+  }
+
+  // Punctuation both code pages put at the same place
+  switch (cp) {
+  case 0x2013: return 0x96;
+  case 0x2014: return 0x97;
+  case 0x2018: return 0x91;
+  case 0x2019: return 0x92;
+  case 0x201C: return 0x93;
+  case 0x201D: return 0x94;
+  case 0x201E: return 0x84;
+  case 0x2026: return 0x85;
+  case 0x20AC: return _codePage == LAWO_CODEPAGE_CP1252 ? 0x80 : 0x88;
+  }
+  return '?';
+}
+
+uint16_t LawoFont::textWidth(const char *text) const {
+  const uint8_t *p = (const uint8_t *)text;
+  uint16_t width = 0;
+  bool any = false;
+  while (*p) {
+    uint32_t cp;
+    p += utf8Decode(p, cp);
+    width += glyphWidth(mapCodepoint(cp)) + _spacing;
+    any = true;
+  }
+  return any ? width - _spacing : 0;
+}
+
+int LawoFont::drawText(MonoBitmap &dst, int x, int y, const char *text) const {
+  if (!_data) return x;
+  const uint8_t *p = (const uint8_t *)text;
+  while (*p && x < dst.width) {
+    uint32_t cp;
+    p += utf8Decode(p, cp);
+    x += drawGlyph(dst, x, y, mapCodepoint(cp)) + _spacing;
+  }
+  return x;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <Arduino.h>
+#include "mono_bitmap.h"
+
+// Glyph rows are assembled in 32-bit words, taller fonts are rejected
+#define LAWO_FONT_MAX_HEIGHT 32
+
+enum LawoCodePage : uint8_t {
+  LAWO_CODEPAGE_CP1252,  // Western, as lawo_font.py reads them
+  LAWO_CODEPAGE_CP1251,  // Cyrillic fonts
+};
+
+/**
+ * @brief LAWO bitmap font (FONTNAME.Fxx, xx = glyph height)
+ *
+ * Works on the file image in place: a font compiled into flash or in a
+ * memory-mapped partition is used without a copy, a LittleFS file is read
+ * once into PSRAM. Text is drawn straight into a MonoBitmap.
+ */
+class LawoFont {
+public:
+  LawoFont() = default;
+  ~LawoFont();
+  LawoFont(const LawoFont &) = delete;
+  LawoFont &operator=(const LawoFont &) = delete;
+
+  /**
+   * @brief Use a font image in memory, which must outlive the font
+   */
+  bool begin(const uint8_t *data, size_t size);
+
+  /**
+   * @brief Read a font file from LittleFS
+   */
+  bool load(const char *path);
+
+  bool valid() const { return _data != nullptr; }
+
+  void setCodePage(LawoCodePage page) { _codePage = page; }
+
+  uint8_t height() const { return _height; }
+  uint8_t baseline() const { return _baseline; }
+  uint8_t spacing() const { return _spacing; }
+
+  /**
+   * @brief FNV-1a of the font data, equal for identical fonts
+   */
+  uint32_t fingerprint() const { return _fingerprint; }
+
+  /**
+   * @return Glyph width in pixels, 0 if the font has no such glyph
+   */
+  uint8_t glyphWidth(uint8_t code) const;
+
+  /**
+   * @brief Width of UTF-8 text including spacing between glyphs
+   */
+  uint16_t textWidth(const char *text) const;
+
+  /**
+   * @brief Draw a glyph with its top-left corner at (x, y), clipped
+   * @return Glyph width
+   */
+  uint8_t drawGlyph(MonoBitmap &dst, int x, int y, uint8_t code) const;
+
+  /**
+   * @brief Draw UTF-8 text with its top-left corner at (x, y), clipped
+   * @return x where the next glyph would start
+   */
+  int drawText(MonoBitmap &dst, int x, int y, const char *text) const;
+
+private:
+  const uint8_t *_data = nullptr;
+  uint8_t *_owned = nullptr;  // set when loaded from a file
+
+  LawoCodePage _codePage = LAWO_CODEPAGE_CP1252;
+  uint8_t _height = 0;
+  uint8_t _baseline = 0;
+  uint8_t _spacing = 0;
+  uint8_t _minChar = 0;
+  uint8_t _maxChar = 0;
+  uint16_t _rowBytes = 0;  // "blocks": every glyph row is this many bytes
+  uint32_t _fingerprint = 0;
+  const uint8_t *_metadata = nullptr;
+  const uint8_t *_glyphs = nullptr;
+
+  uint16_t glyphOffset(uint8_t code) const;
+  uint8_t mapCodepoint(uint32_t cp) const;
+  void release();
+};
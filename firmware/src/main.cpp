@@ -10,10 +10,44 @@
 #include <lvgl.h>
 #include "ui_app.h"
 #include "file_manager.h"
+#include "route_cache.h"
+#include "frame_cache.h"
+#include "io_worker.h"
 #include "config.h"
 #include "ibis_protocol.h"
+#include "ibis_scheduler.h"
+#include "ibis_receiver.h"
+#include "uart_transport.h"
+#include "mono_link.h"
+#include "mono_discovery.h"
+
+// Configurations from before ALFA_SIGN_TYPE only drove flipdot signs, one
+// 112x16 sign at address 1
+#ifndef ALFA_SIGN_TYPE
+#define ALFA_SIGN_TYPE MONO_SIGN_FLIPDOT
+#endif
+#ifndef ALFA_SIGN_ADDRESS
+#define ALFA_SIGN_ADDRESS 1
+#endif
+#ifndef ALFA_SIGN_WIDTH
+#define ALFA_SIGN_WIDTH 112
+#endif
+#ifndef ALFA_SIGN_HEIGHT
+#define ALFA_SIGN_HEIGHT 16
+#endif
+#ifndef ALFA_SIGN_COLUMN_OFFSET
+#define ALFA_SIGN_COLUMN_OFFSET 0
+#endif
 
-IbisProtocol ibis(Serial2);
+// Sign buses run on the IDF UART driver, not on Serial1/Serial2
+UartTransport ibisUart(UART_NUM_2);
+UartTransport alfaUart(UART_NUM_1);
+MonoLink alfaLink(alfaUart);
+IbisProtocol ibis(ibisUart);
+IbisScheduler ibisScheduler(ibis);
+#if PIN_ALFA_RX >= 0
+MonoDiscovery monoDiscovery(alfaLink);
+#endif
 
 /**
  * To use the built-in examples and demos of LVGL uncomment the includes below
@@ -32,15 +66,27 @@ void setup() {
 
   // Initialize Protocols
 
-  Serial2.begin(1200, SERIAL_7E2, PIN_IBIS_RX, PIN_IBIS_TX);
-  ibis.begin();  // This calls Serial2.begin(1200, SERIAL_7E2) inside.
-  // We need to ensure specific pins are used unless default.
-  // Re-calling begin with pins:
-  Serial2.begin(1200, SERIAL_7E2, PIN_IBIS_RX, PIN_IBIS_TX);
+  ibis.begin(PIN_IBIS_RX, PIN_IBIS_TX);
+#ifdef IBIS_CODE_PAGE
+  ibis.setCodePage(IBIS_CODE_PAGE, IBIS_FALLBACK_CHAR);
+#endif
+  if (!ibisScheduler.begin()) {
+    Serial.println("Failed to start IBIS scheduler!");
+  }
+#if PIN_IBIS_RX >= 0
+  // The vehicle's IBIS master owns the bus, we only listen to it
+  ibisScheduler.setListenOnly(true);
+#endif
 
   // Initialize Alfa Serial 3
   Serial.println("Initializing Alfa Serial");
-  Serial1.begin(ALFA_BAUD_RATE, ALFA_SERIAL_CONFIG, PIN_ALFA_RX, PIN_ALFA_TX);
+  if (!alfaUart.begin(ALFA_BAUD_RATE, ALFA_SERIAL_CONFIG, PIN_ALFA_RX,
+                      PIN_ALFA_TX)) {
+    Serial.println("Failed to set up the Alfa UART!");
+  }
+  if (!alfaLink.begin(PIN_ALFA_RX >= 0)) {
+    Serial.println("Failed to start the MONO link!");
+  }
 
   Serial.println("Initializing board");
   Board *board = new Board();
@@ -72,12 +118,56 @@ void setup() {
   Serial.println("Creating UI");
 
   static FileManager fileManager;
+  static RouteCache routeCache(fileManager);
+  static IoWorker ioWorker(routeCache, ibisScheduler, alfaUart);
   static IndexData indexData;
   static UIApp uiApp;
 
   if (!fileManager.init()) {
     Serial.println("Failed to init filesystem!");
   }
+  static FrameCache frameCache;
+  if (frameCache.begin()) {
+    ioWorker.setFrameCache(&frameCache);
+  } else {
+    Serial.println("Failed to open the frame cache!");
+  }
+  if (!routeCache.begin()) {
+    Serial.println("Failed to start route prefetch task!");
+  }
+  // Bitmap assets, and route text with a font, are drawn on one canvas and
+  // framed for every panel of the layout
+#ifdef ALFA_PANELS
+  static const MonoPanel alfaPanels[] = ALFA_PANELS;
+#else
+  static const MonoPanel alfaPanels[] = {
+      {ALFA_SIGN_TYPE, ALFA_SIGN_ADDRESS, ALFA_SIGN_WIDTH, ALFA_SIGN_HEIGHT, 0,
+       0, ALFA_SIGN_COLUMN_OFFSET}};
+#endif
+  static FlipdotSender flipdot(alfaLink);
+  alfaLink.onReply(FlipdotSender::on_link_reply, &flipdot);
+  static SignLayout signLayout(alfaLink, flipdot);
+  alfaLink.onReply(SignLayout::on_link_reply, &signLayout);
+  if (signLayout.begin(alfaPanels,
+                       sizeof(alfaPanels) / sizeof(alfaPanels[0]))) {
+    ioWorker.setSignLayout(&signLayout);
+  } else {
+    Serial.println("Invalid Alfa panel layout, using .bin files only");
+  }
+#ifdef ALFA_LONG_TEXT
+  ioWorker.setLongText(ALFA_LONG_TEXT);
+#endif
+#ifdef ALFA_FONT_PATH
+  static LawoFont alfaFont;
+  if (alfaFont.load(ALFA_FONT_PATH)) {
+    ioWorker.setFont(&alfaFont);
+  } else {
+    Serial.println("Failed to load the Alfa font, using the route files");
+  }
+#endif
+  if (!ioWorker.begin(UIApp::on_worker_progress, &uiApp)) {
+    Serial.println("Failed to start I/O worker!");
+  }
 
   // Try to read index, create dummy if empty for testing robustness
   if (!fileManager.readIndex(indexData)) {
@@ -89,12 +179,33 @@ void setup() {
   /* Lock the mutex due to the LVGL APIs are not thread-safe */
   lvgl_port_lock(-1);
 
-  uiApp.init(&fileManager, &indexData, &ibis);
+  uiApp.init(&routeCache, &ioWorker, &indexData);
 
   /* Release the mutex */
   lvgl_port_unlock();
+
+#if PIN_ALFA_RX >= 0
+  // Find the displays on the Alfa bus; updates then skip empty addresses
+  if (monoDiscovery.begin()) {
+    monoDiscovery.scan();
+  } else {
+    Serial.println("Failed to start MONO discovery!");
+  }
+#endif
+
+#if PIN_IBIS_RX >= 0
+  // Follow the route set by the vehicle's IBIS master
+  static IbisReceiver ibisReceiver(ibisUart, indexData);
+  if (!ibisReceiver.begin(UIApp::on_ibis_route, &uiApp)) {
+    Serial.println("Failed to start IBIS receiver!");
+  }
+#endif
 }
 
 void loop() {
+#if PIN_ALFA_RX >= 0
+  // Displays that were off or missed the boot scan join later
+  monoDiscovery.poll();
+#endif
   delay(10);
 }
@@ -0,0 +1,138 @@
+#include "mono_discovery.h"
+#include <Preferences.h>
+
+#define NVS_NAMESPACE "mono"
+#define NVS_KEY_DISPLAYS "displays"
+
+MonoDiscovery::MonoDiscovery(MonoLink &link) : _link(link) {}
+
+bool MonoDiscovery::begin() {
+  load();
+  uint16_t mask = presentMask();
+  if (mask) _link.setPresent(mask);
+  return _link.onReply(on_link_reply, this);
+}
+
+uint16_t MonoDiscovery::scan(uint16_t timeoutMs) {
+  portENTER_CRITICAL(&_mux);
+  for (MonoDisplayInfo &display : _displays) display.present = false;
+  portEXIT_CRITICAL(&_mux);
+
+  // Replies only set the mask once the scan is complete
+  _scanning = true;
+  uint32_t start = millis();
+  probe(0xFFFF, timeoutMs);
+  uint32_t perAddress = (MONO_DISCOVERY_RETRIES + 1) * (timeoutMs + 50);
+  if (!_link.waitIdle(MONO_LINK_ADDRESSES * perAddress + 1000)) {
+    Serial.println("MONO discovery: timed out");
+  }
+  _scanning = false;
+  _scanned = true;
+  _lastProbe = millis();
+
+  uint16_t mask = presentMask();
+  applyMask(mask);
+  save();
+  Serial.printf("MONO discovery: displays %04x in %u ms\n", (unsigned)mask,
+                (unsigned)(millis() - start));
+  return mask;
+}
+
+void MonoDiscovery::poll() {
+  if (!_scanned || millis() - _lastProbe < MONO_DISCOVERY_RESCAN_MS) return;
+  _lastProbe = millis();
+  uint16_t absent = ~presentMask();
+  if (absent) probe(absent, MONO_DISCOVERY_TIMEOUT_MS);
+}
+
+void MonoDiscovery::probe(uint16_t addresses, uint16_t timeoutMs) {
+  // All queries are queued at once; the link sends them back to back and
+  // moves on as soon as an address has answered or timed out
+  uint8_t frame[MONO_FRAME_MAX];
+  for (uint8_t address = 0; address < MONO_LINK_ADDRESSES; address++) {
+    if (!(addresses & (1 << address))) continue;
+    BufferTransport buffer(frame, sizeof(frame));
+    MonoEncoder<BufferTransport> encoder(buffer);
+    encoder.query(address);
+    _link.write(ByteSpan{buffer.data(), buffer.length()}, timeoutMs,
+                MONO_DISCOVERY_RETRIES);
+  }
+}
+
+MonoDisplayInfo MonoDiscovery::info(uint8_t address) {
+  portENTER_CRITICAL(&_mux);
+  MonoDisplayInfo copy = _displays[address & 0x0F];
+  portEXIT_CRITICAL(&_mux);
+  return copy;
+}
+
+uint16_t MonoDiscovery::presentMask() {
+  uint16_t mask = 0;
+  portENTER_CRITICAL(&_mux);
+  for (uint8_t address = 0; address < MONO_LINK_ADDRESSES; address++) {
+    if (_displays[address].present) mask |= 1 << address;
+  }
+  portEXIT_CRITICAL(&_mux);
+  return mask;
+}
+
+void MonoDiscovery::on_link_reply(void *ctx,
+                                  uint8_t command,
+                                  uint8_t address,
+                                  const uint8_t *reply,
+                                  size_t len) {
+  // Only query replies describe the display, but any unanswered command
+  // means it is gone
+  if (command == MONO_CMD_QUERY || !reply) {
+    ((MonoDiscovery *)ctx)->record(address, reply, len);
+  }
+}
+
+void MonoDiscovery::record(uint8_t address,
+                           const uint8_t *reply,
+                           size_t len) {
+  MonoDisplayInfo &display = _displays[address & 0x0F];
+  portENTER_CRITICAL(&_mux);
+  bool wasPresent = display.present;
+  display.present = reply != nullptr;
+  if (reply && len >= 2) {
+    // Strip the command byte and the checksum
+    display.replyLen = min(len - 2, (size_t)MONO_DISPLAY_REPLY_MAX);
+    memcpy(display.reply, reply + 1, display.replyLen);
+  }
+  portEXIT_CRITICAL(&_mux);
+
+  // A display that stopped answering is skipped from now on, one that
+  // answered a later probe is sent to again. The scan itself sets the mask
+  // once it is complete.
+  if (wasPresent != (reply != nullptr) && !_scanning) {
+    applyMask(presentMask());
+    Serial.printf("MONO discovery: display %u %s\n",
+                  (unsigned)(address & 0x0F), reply ? "found" : "lost");
+  }
+}
+
+void MonoDiscovery::applyMask(uint16_t mask) {
+  // No display at all is more likely a wiring problem than an empty bus:
+  // keep sending blind
+  _link.setPresent(mask ? mask : 0xFFFF);
+}
+
+void MonoDiscovery::load() {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, true)) return;
+  if (prefs.getBytesLength(NVS_KEY_DISPLAYS) == sizeof(_displays)) {
+    prefs.getBytes(NVS_KEY_DISPLAYS, _displays, sizeof(_displays));
+  }
+  prefs.end();
+}
+
+void MonoDiscovery::save() {
+  Preferences prefs;
+  if (!prefs.begin(NVS_NAMESPACE, false)) {
+    Serial.println("MONO discovery: NVS not available");
+    return;
+  }
+  prefs.putBytes(NVS_KEY_DISPLAYS, _displays, sizeof(_displays));
+  prefs.end();
+}
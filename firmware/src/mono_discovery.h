@@ -0,0 +1,88 @@
+#pragma once
+#include <Arduino.h>
+#include "mono_link.h"
+
+// Reply wait per address while scanning. A query and a short reply take
+// under 10 ms at 19200 baud, so an empty address costs little more.
+#ifndef MONO_DISCOVERY_TIMEOUT_MS
+#define MONO_DISCOVERY_TIMEOUT_MS 30
+#endif
+
+// Query retries per address. One probe can be lost to a display that is
+// still busy or to line noise; a second one costs only another timeout.
+#ifndef MONO_DISCOVERY_RETRIES
+#define MONO_DISCOVERY_RETRIES 1
+#endif
+
+// How often poll() probes the addresses that did not answer
+#ifndef MONO_DISCOVERY_RESCAN_MS
+#define MONO_DISCOVERY_RESCAN_MS 30000
+#endif
+
+// Reply payload kept per display
+#define MONO_DISPLAY_REPLY_MAX 16
+
+struct MonoDisplayInfo {
+  bool present;
+  uint8_t replyLen;
+  // Query reply without command byte and checksum. Its layout is not
+  // documented in the Python tools, so it is kept raw.
+  uint8_t reply[MONO_DISPLAY_REPLY_MAX];
+};
+
+/**
+ * @brief Finds the displays on the MONO bus and remembers them in NVS
+ *
+ * A scan queues CMD_QUERY for all 16 addresses back to back, each with a
+ * short timeout and MONO_DISCOVERY_RETRIES retries, and records who
+ * answered. The result sets the link's present mask, so updates skip
+ * empty addresses. A display that stops answering later is marked absent;
+ * poll() probes absent addresses again, so displays that boot later than
+ * we do or were off join without a restart. When no display answers at
+ * all, frames go to every address as before discovery.
+ */
+class MonoDiscovery {
+public:
+  explicit MonoDiscovery(MonoLink &link);
+
+  /**
+   * @brief Restore the last scan from NVS and listen to link replies
+   */
+  bool begin();
+
+  /**
+   * @brief Query every address and save the result (blocking)
+   * @return Mask of the addresses that answered
+   */
+  uint16_t scan(uint16_t timeoutMs = MONO_DISCOVERY_TIMEOUT_MS);
+
+  /**
+   * @brief Probe the absent addresses every MONO_DISCOVERY_RESCAN_MS
+   *
+   * Call regularly after the first scan. The queries are only queued;
+   * displays that answer are added to the present mask as they reply.
+   */
+  void poll();
+
+  MonoDisplayInfo info(uint8_t address);
+  uint16_t presentMask();
+
+private:
+  MonoLink &_link;
+  MonoDisplayInfo _displays[MONO_LINK_ADDRESSES] = {};
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  volatile bool _scanning = false;
+  bool _scanned = false;
+  uint32_t _lastProbe = 0;
+
+  static void on_link_reply(void *ctx,
+                            uint8_t command,
+                            uint8_t address,
+                            const uint8_t *reply,
+                            size_t len);
+  void probe(uint16_t addresses, uint16_t timeoutMs);
+  void record(uint8_t address, const uint8_t *reply, size_t len);
+  void applyMask(uint16_t mask);
+  void load();
+  void save();
+};
@@ -0,0 +1,289 @@
+#include "mono_link.h"
+#include <esp_heap_caps.h>
+#include <freertos/task.h>
+
+#define LINK_IDLE BIT0
+
+MonoLink::MonoLink(UartTransport &uart) : _uart(uart) {
+  for (uint8_t i = 0; i < MONO_LINK_ADDRESSES; i++) {
+    _head[i] = -1;
+    _tail[i] = -1;
+  }
+}
+
+bool MonoLink::begin(bool hasRx) {
+  _hasRx = hasRx;
+  _slots = (Slot *)heap_caps_malloc(MONO_LINK_SLOTS * sizeof(Slot),
+                                    MALLOC_CAP_SPIRAM);
+  if (!_slots) {
+    _slots = (Slot *)heap_caps_malloc(MONO_LINK_SLOTS * sizeof(Slot),
+                                      MALLOC_CAP_DEFAULT);
+  }
+  _lock = xSemaphoreCreateMutex();
+  _freeSlots = xSemaphoreCreateCounting(MONO_LINK_SLOTS, MONO_LINK_SLOTS);
+  _events = xEventGroupCreate();
+  if (!_slots || !_lock || !_freeSlots || !_events) return false;
+
+  for (int8_t i = 0; i < MONO_LINK_SLOTS; i++) {
+    _slots[i].next = i + 1 < MONO_LINK_SLOTS ? i + 1 : -1;
+  }
+  _free = 0;
+  xEventGroupSetBits(_events, LINK_IDLE);
+
+  return xTaskCreatePinnedToCore(task, "mono_link", 4096, this, 3, &_task,
+                                 ARDUINO_RUNNING_CORE ? 0 : 1) == pdPASS;
+}
+
+bool MonoLink::onReply(ReplyCallback callback, void *ctx) {
+  for (Listener &listener : _listeners) {
+    if (listener.callback) continue;
+    listener.ctx = ctx;
+    listener.callback = callback;
+    return true;
+  }
+  return false;
+}
+
+void MonoLink::notify(uint8_t command,
+                      uint8_t address,
+                      const uint8_t *reply,
+                      size_t len) {
+  for (const Listener &listener : _listeners) {
+    if (!listener.callback) continue;
+    listener.callback(listener.ctx, command, address, reply, len);
+  }
+}
+
+MonoLink::Timing MonoLink::timingFor(uint8_t command) {
+  // Busy times are the sleeps of mono_protocol.py after each command
+  uint16_t ack = MONO_LINK_ACK_ALL ? 100 : 0;
+  switch (command & 0xF0) {
+  case MONO_CMD_QUERY:
+    return {0, 100};
+  case MONO_CMD_COLUMN_DATA_FLIPDOT:
+    return {20, ack};
+  default:
+    return {50, ack};
+  }
+}
+
+size_t MonoLink::write(ByteSpan frame) {
+  if (frame.size < 2) return 0;
+  uint16_t timeout = timingFor(frame.data[1]).replyTimeoutMs;
+  return write(frame, timeout, MONO_LINK_RETRIES);
+}
+
+size_t MonoLink::write(ByteSpan frame,
+                       uint16_t replyTimeoutMs,
+                       uint8_t retries) {
+  if (!_slots || frame.size < 4 || frame.size > MONO_FRAME_MAX ||
+      frame.data[0] != MONO_FRAME_DELIMITER ||
+      frame.data[frame.size - 1] != MONO_FRAME_DELIMITER) {
+    return 0;
+  }
+  // The command byte is never escaped: no command nibble is 7
+  uint8_t address = frame.data[1] & 0x0F;
+  if (!present(address) && (frame.data[1] & 0xF0) != MONO_CMD_QUERY) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    _stats.skipped++;
+    xSemaphoreGive(_lock);
+    return 0;
+  }
+
+  xSemaphoreTake(_freeSlots, portMAX_DELAY);
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  int8_t index = _free;
+  Slot &slot = _slots[index];
+  _free = slot.next;
+  memcpy(slot.data, frame.data, frame.size);
+  slot.len = frame.size;
+  slot.replyTimeoutMs = replyTimeoutMs;
+  slot.retries = retries;
+  slot.attempts = 0;
+  slot.next = -1;
+  if (_tail[address] >= 0) {
+    _slots[_tail[address]].next = index;
+  } else {
+    _head[address] = index;
+  }
+  _tail[address] = index;
+  _pending++;
+  xEventGroupClearBits(_events, LINK_IDLE);
+  xSemaphoreGive(_lock);
+
+  xTaskNotifyGive(_task);
+  return frame.size;
+}
+
+size_t MonoLink::writeFrames(ByteSpan stream) {
+  // Every frame has its own opening and closing delimiter
+  size_t total = 0;
+  size_t start = 0;
+  while (start < stream.size) {
+    if (stream.data[start] != MONO_FRAME_DELIMITER) {
+      start++;
+      continue;
+    }
+    size_t end = start + 1;
+    while (end < stream.size && stream.data[end] != MONO_FRAME_DELIMITER) {
+      end++;
+    }
+    if (end >= stream.size) break;
+    total += write(ByteSpan{stream.data + start, end - start + 1});
+    start = end + 1;
+  }
+  return total;
+}
+
+bool MonoLink::waitIdle(uint32_t timeoutMs) {
+  if (!_events) return true;
+  return xEventGroupWaitBits(_events, LINK_IDLE, pdFALSE, pdTRUE,
+                             pdMS_TO_TICKS(timeoutMs)) &
+         LINK_IDLE;
+}
+
+MonoLinkStats MonoLink::stats() {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  MonoLinkStats copy = _stats;
+  xSemaphoreGive(_lock);
+  return copy;
+}
+
+int8_t MonoLink::nextReady(uint32_t now, uint32_t &waitMs) {
+  // Round robin over the addresses whose display is no longer busy
+  waitMs = UINT32_MAX;
+  for (uint8_t i = 0; i < MONO_LINK_ADDRESSES; i++) {
+    uint8_t address = (_nextAddress + i) % MONO_LINK_ADDRESSES;
+    if (_head[address] < 0) continue;
+    int32_t remaining = (int32_t)(_busyUntil[address] - now);
+    if (remaining <= 0) {
+      _nextAddress = (address + 1) % MONO_LINK_ADDRESSES;
+      return address;
+    }
+    waitMs = min(waitMs, (uint32_t)remaining);
+  }
+  return -1;
+}
+
+void MonoLink::complete(uint8_t address) {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  int8_t index = _head[address];
+  _head[address] = _slots[index].next;
+  if (_head[address] < 0) _tail[address] = -1;
+  _slots[index].next = _free;
+  _free = index;
+  if (--_pending == 0) xEventGroupSetBits(_events, LINK_IDLE);
+  xSemaphoreGive(_lock);
+  xSemaphoreGive(_freeSlots);
+}
+
+bool MonoLink::onFrame() {
+  // A half-duplex transceiver hands our own frame back first
+  if (_echoLen == _rx.length() &&
+      memcmp(_echo, _rx.frame(), _echoLen) == 0) {
+    _echoLen = 0;
+    _stats.echoes++;
+    return false;
+  }
+  return true;
+}
+
+void MonoLink::drainRx() {
+  if (!_hasRx) return;
+  uint8_t buf[32];
+  size_t len;
+  while ((len = _uart.read(buf, min(sizeof(buf), _uart.available()), 0))) {
+    for (size_t i = 0; i < len; i++) {
+      MonoDeframer::Result result = _rx.feed(buf[i]);
+      if (result == MonoDeframer::BAD_FRAME) _stats.badFrames++;
+      if (result == MonoDeframer::FRAME && onFrame()) _stats.stray++;
+    }
+  }
+}
+
+bool MonoLink::awaitReply(uint32_t timeoutMs) {
+  uint32_t start = millis();
+  uint8_t buf[32];
+  while (true) {
+    uint32_t elapsed = millis() - start;
+    if (elapsed >= timeoutMs) return false;
+
+    // Wait for one byte, then take whatever else has arrived
+    size_t len = _uart.read(buf, 1, timeoutMs - elapsed);
+    if (len == 0) continue;
+    len += _uart.read(buf + 1, min(sizeof(buf) - 1, _uart.available()), 0);
+
+    for (size_t i = 0; i < len; i++) {
+      MonoDeframer::Result result = _rx.feed(buf[i]);
+      if (result == MonoDeframer::BAD_FRAME) _stats.badFrames++;
+      // Bytes after the reply stay in the driver for the next drainRx()
+      if (result == MonoDeframer::FRAME && onFrame()) return true;
+    }
+  }
+}
+
+void MonoLink::transmit(uint8_t address, Slot &slot) {
+  Timing timing = timingFor(slot.data[1]);
+  bool expectReply = _hasRx && slot.replyTimeoutMs > 0;
+
+  drainRx();
+  if (_hasRx) {
+    // Unescaped copy of the frame to recognise its echo, which for frames
+    // without a reply is only read by the next drainRx()
+    MonoDeframer echo;
+    for (size_t i = 0; i < slot.len; i++) {
+      if (echo.feed(slot.data[i]) == MonoDeframer::FRAME) {
+        _echoLen = echo.length();
+        memcpy(_echo, echo.frame(), _echoLen);
+      }
+    }
+  }
+
+  _uart.write(slot.data, slot.len);
+  _uart.flush();
+  slot.attempts++;
+  _stats.sent++;
+
+  bool done = true;
+  if (expectReply) {
+    if (awaitReply(slot.replyTimeoutMs)) {
+      _stats.replies++;
+      notify(slot.data[1] & 0xF0, address, _rx.frame(), _rx.length());
+    } else {
+      _stats.timeouts++;
+      if (slot.attempts <= slot.retries) {
+        done = false;  // stays at the head and goes out again
+      } else {
+        _stats.failed++;
+        // Probes without retries (discovery) are expected to go unanswered
+        if (slot.retries) {
+          Serial.printf("MONO: no reply from address %u\n", (unsigned)address);
+        }
+        notify(slot.data[1] & 0xF0, address, nullptr, 0);
+      }
+    }
+  }
+
+  _busyUntil[address] = millis() + timing.busyMs;
+  if (done) complete(address);
+}
+
+void MonoLink::task(void *arg) {
+  MonoLink *link = (MonoLink *)arg;
+  while (true) {
+    uint32_t waitMs;
+    xSemaphoreTake(link->_lock, portMAX_DELAY);
+    int8_t address = link->nextReady(millis(), waitMs);
+    Slot *slot = address >= 0 ? &link->_slots[link->_head[address]] : nullptr;
+    xSemaphoreGive(link->_lock);
+
+    if (!slot) {
+      // Woken by a new frame or when the first busy display frees up
+      ulTaskNotifyTake(pdTRUE, waitMs == UINT32_MAX
+                                   ? portMAX_DELAY
+                                   : pdMS_TO_TICKS(waitMs) + 1);
+      continue;
+    }
+    link->transmit(address, *slot);
+  }
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include "mono_deframer.h"
+#include "mono_encoder.h"
+#include "uart_transport.h"
+
+// Frames that can wait in the link at once, over all addresses
+#ifndef MONO_LINK_SLOTS
+#define MONO_LINK_SLOTS 32
+#endif
+
+// How often a command that expects a reply is sent before giving up
+#ifndef MONO_LINK_RETRIES
+#define MONO_LINK_RETRIES 2
+#endif
+
+// Set to 1 if the signs answer every command, not only queries; each one
+// is then confirmed and retried
+#ifndef MONO_LINK_ACK_ALL
+#define MONO_LINK_ACK_ALL 0
+#endif
+
+// Reply callbacks that can be registered
+#define MONO_LINK_LISTENERS 4
+
+#define MONO_LINK_ADDRESSES 16
+
+struct MonoLinkStats {
+  uint32_t sent;        // frames transmitted, retries included
+  uint32_t replies;
+  uint32_t timeouts;    // replies that did not come in time
+  uint32_t failed;      // frames dropped after the last retry
+  uint32_t echoes;      // own frames read back from the bus
+  uint32_t badFrames;   // checksum or framing errors on RX
+  uint32_t stray;       // valid frames nobody waited for
+  uint32_t skipped;     // frames for displays known to be absent
+};
+
+/**
+ * @brief MONO bus master: queues frames per address and sends them with
+ * the timing each command needs
+ *
+ * After a command a display stays busy for a while (mono_protocol.py
+ * sleeps 20-50 ms). Instead of sleeping, the link sends queued frames for
+ * other addresses in the meantime, so a multi-sign update takes about the
+ * bus time. Frames for one address keep their order.
+ *
+ * Commands that expect a reply hold the bus until it arrives, so a reply
+ * always belongs to the frame in flight. The reply is deframed, its
+ * checksum checked and our own echo skipped; missing replies are retried
+ * up to MONO_LINK_RETRIES times. Without an RX pin nothing is awaited.
+ *
+ * Once discovery has set the present displays, frames other than queries
+ * to any other address are dropped instead of waiting out their timeouts.
+ *
+ * Implements the transport interface of sign_transport.h for MonoEncoder:
+ * write() takes one complete frame, flush() does not wait (see waitIdle).
+ */
+class MonoLink {
+public:
+  /**
+   * @param command Command nibble of the frame that was answered
+   * @param reply Frame without delimiters, nullptr if the display did not
+   * answer after all retries
+   */
+  typedef void (*ReplyCallback)(void *ctx,
+                                uint8_t command,
+                                uint8_t address,
+                                const uint8_t *reply,
+                                size_t len);
+
+  explicit MonoLink(UartTransport &uart);
+
+  /**
+   * @param hasRx Whether the bus RX line is connected
+   */
+  bool begin(bool hasRx);
+
+  /**
+   * @brief Add a listener, called from the link task in the order added
+   * @return false if all MONO_LINK_LISTENERS are taken
+   */
+  bool onReply(ReplyCallback callback, void *ctx);
+
+  /**
+   * @brief Bit n set when a display answers at address n (default: all)
+   */
+  void setPresent(uint16_t mask) { _present = mask; }
+  bool present(uint8_t address) const {
+    return (_present >> (address & 0x0F)) & 1;
+  }
+
+  /**
+   * @brief Queue one encoded frame, waiting for a free slot if needed
+   * @return Bytes queued, 0 if it is not a single MONO frame
+   */
+  size_t write(ByteSpan frame);
+
+  /**
+   * @brief Queue one frame with its own reply timeout and retry count
+   * @param replyTimeoutMs 0 if no reply is expected
+   */
+  size_t write(ByteSpan frame, uint16_t replyTimeoutMs, uint8_t retries);
+  void flush() {}
+  uint32_t now() { return millis(); }
+
+  /**
+   * @brief Queue back-to-back encoded frames, e.g. a cached stream
+   * @return Bytes queued
+   */
+  size_t writeFrames(ByteSpan stream);
+
+  /**
+   * @brief Block until every queued frame has been sent (and answered)
+   * @return false on timeout
+   */
+  bool waitIdle(uint32_t timeoutMs);
+
+  MonoLinkStats stats();
+
+private:
+  struct Slot {
+    uint16_t len;
+    uint16_t replyTimeoutMs;
+    uint8_t retries;
+    uint8_t attempts;
+    int8_t next;
+    uint8_t data[MONO_FRAME_MAX];
+  };
+
+  struct Timing {
+    uint16_t busyMs;          // display ignores the bus for this long
+    uint16_t replyTimeoutMs;  // 0 if no reply is expected
+  };
+
+  UartTransport &_uart;
+  bool _hasRx = false;
+  struct Listener {
+    ReplyCallback callback;
+    void *ctx;
+  };
+  Listener _listeners[MONO_LINK_LISTENERS] = {};
+  volatile uint16_t _present = 0xFFFF;
+
+  Slot *_slots = nullptr;
+  int8_t _free = -1;
+  int8_t _head[MONO_LINK_ADDRESSES];
+  int8_t _tail[MONO_LINK_ADDRESSES];
+  uint32_t _busyUntil[MONO_LINK_ADDRESSES] = {};
+  uint8_t _nextAddress = 0;  // round robin start
+  uint32_t _pending = 0;
+
+  SemaphoreHandle_t _lock = nullptr;
+  SemaphoreHandle_t _freeSlots = nullptr;
+  EventGroupHandle_t _events = nullptr;
+  TaskHandle_t _task = nullptr;
+  MonoLinkStats _stats = {};
+
+  MonoDeframer _rx;
+  uint8_t _echo[MONO_RAW_MAX];
+  size_t _echoLen = 0;
+
+  static Timing timingFor(uint8_t command);
+  static void task(void *arg);
+  int8_t nextReady(uint32_t now, uint32_t &waitMs);
+  void transmit(uint8_t address, Slot &slot);
+  bool awaitReply(uint32_t timeoutMs);
+  void drainRx();
+  bool onFrame();
+  void complete(uint8_t address);
+  void notify(uint8_t command,
+              uint8_t address,
+              const uint8_t *reply,
+              size_t len);
+};
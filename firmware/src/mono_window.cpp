@@ -0,0 +1,71 @@
+#include "mono_window.h"
+
+void monoCopyWindow(const MonoBitmap &src,
+                    uint16_t x,
+                    uint16_t y,
+                    MonoBitmap &dst) {
+  size_t srcStride = src.stride();
+  size_t stride = dst.stride();
+  uint8_t shift = y % 8;
+  size_t first = y / 8;
+  // Rows past the window's bottom edge are cleared in its last byte
+  uint8_t lastMask = dst.height % 8 ? (1 << (dst.height % 8)) - 1 : 0xFF;
+
+  for (uint16_t i = 0; i < dst.width; i++) {
+    const uint8_t *in = src.column(x + i);
+    uint8_t *out = dst.data + i * stride;
+    if (shift == 0) {
+      memcpy(out, in + first, stride);
+    } else {
+      for (size_t b = 0; b < stride; b++) {
+        size_t k = first + b;
+        uint8_t next = k + 1 < srcStride ? in[k + 1] : 0;
+        out[b] = in[k] >> shift | next << (8 - shift);
+      }
+    }
+    out[stride - 1] &= lastMask;
+  }
+}
+
+void monoCopyColumnsWrapped(const MonoBitmap &src,
+                            uint32_t offset,
+                            uint32_t cycle,
+                            MonoBitmap &dst) {
+  // Bitmaps are column-major, so every column is one copy
+  size_t stride = dst.stride();
+  for (uint16_t x = 0; x < dst.width; x++) {
+    uint32_t column = cycle ? (offset + x) % cycle : x;
+    uint8_t *out = dst.data + x * stride;
+    if (column < src.width) {
+      memcpy(out, src.column(column), stride);
+    } else {
+      memset(out, 0, stride);
+    }
+  }
+}
+
+uint32_t monoRowBits(const uint8_t *row, uint32_t bit, uint8_t count) {
+  const uint8_t *p = row + (bit >> 3);
+  uint8_t shift = bit & 7;
+  size_t bytes = (shift + count + 7) / 8;
+  uint64_t word = 0;
+  for (size_t i = 0; i < bytes; i++) word |= (uint64_t)p[i] << (56 - 8 * i);
+  word <<= shift;
+  uint32_t mask = count >= 32 ? 0xFFFFFFFFUL : ~(0xFFFFFFFFUL >> count);
+  return (uint32_t)(word >> 32) & mask;
+}
+
+void monoOrColumn(MonoBitmap &dst, int x, int y, uint32_t bits) {
+  if (x < 0 || x >= dst.width || bits == 0) return;
+
+  int base = (y >= 0) ? y / 8 : -((7 - y) / 8);  // floor(y / 8)
+  uint64_t word = (uint64_t)bits << (y - base * 8);
+  uint8_t *column = dst.data + x * dst.stride();
+  int stride = dst.stride();
+  for (int k = 0; k < 5 && word; k++, word >>= 8) {
+    int b = base + k;
+    if (b >= 0 && b < stride) column[b] |= (uint8_t)word;
+  }
+
+  if (dst.height % 8) column[stride - 1] &= (1 << (dst.height % 8)) - 1;
+}
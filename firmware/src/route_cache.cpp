@@ -0,0 +1,90 @@
+#include "route_cache.h"
+#include <freertos/task.h>
+
+RouteCache::RouteCache(FileManager &fileManager) : _fileManager(fileManager) {}
+
+bool RouteCache::begin() {
+  _lock = xSemaphoreCreateMutex();
+  // Depth 1: a newer selection replaces a prefetch that has not started yet
+  _prefetchQueue = xQueueCreate(1, sizeof(PrefetchRequest));
+  if (!_lock || !_prefetchQueue) return false;
+
+  // Run on the core LVGL does not use
+  return xTaskCreatePinnedToCore(prefetchTask, "route_prefetch", 4096, this, 1,
+                                 nullptr, ARDUINO_RUNNING_CORE ? 0 : 1) ==
+         pdPASS;
+}
+
+bool RouteCache::get(const char *id, int type, RouteDetails &details) {
+  return fetch(id, type, details, false);
+}
+
+bool RouteCache::fetch(const char *id,
+                       int type,
+                       RouteDetails &details,
+                       bool background) {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+
+  Slot *victim = &_slots[0];
+  for (Slot &slot : _slots) {
+    if (slot.used && slot.type == type && strcmp(slot.details.id, id) == 0) {
+      slot.lastUse = ++_clock;
+      if (!background) _stats.hits++;
+      details = slot.details;
+      xSemaphoreGive(_lock);
+      return true;
+    }
+    // Prefer an empty slot, otherwise the least recently used one
+    if (victim->used && (!slot.used || slot.lastUse < victim->lastUse)) {
+      victim = &slot;
+    }
+  }
+
+  if (background)
+    _stats.prefetches++;
+  else
+    _stats.misses++;
+  // Reading under the lock also serialises FileManager, which is not
+  // thread-safe, and lets get() wait for a prefetch of the same route.
+  bool ok = _fileManager.readRoute(id, details, type);
+  if (ok) {
+    if (victim->used) _stats.evictions++;
+    victim->used = true;
+    victim->type = type;
+    victim->lastUse = ++_clock;
+    victim->details = details;
+  }
+
+  xSemaphoreGive(_lock);
+  return ok;
+}
+
+void RouteCache::prefetch(const char *id, int type) {
+  PrefetchRequest request;
+  if (!_prefetchQueue || strlen(id) >= sizeof(request.id)) return;
+  strcpy(request.id, id);
+  request.type = type;
+  xQueueOverwrite(_prefetchQueue, &request);
+}
+
+RouteCacheStats RouteCache::stats() {
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  RouteCacheStats copy = _stats;
+  xSemaphoreGive(_lock);
+  return copy;
+}
+
+void RouteCache::prefetchTask(void *arg) {
+  RouteCache *cache = (RouteCache *)arg;
+  PrefetchRequest request;
+  RouteDetails details;
+
+  while (true) {
+    if (xQueueReceive(cache->_prefetchQueue, &request, portMAX_DELAY) !=
+        pdTRUE) {
+      continue;
+    }
+    cache->fetch(request.id, request.type, details, true);
+    details = RouteDetails();  // drop our reference to the storage
+  }
+}
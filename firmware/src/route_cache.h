@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "file_manager.h"
+
+#ifndef ROUTE_CACHE_SIZE
+#define ROUTE_CACHE_SIZE 16
+#endif
+
+struct RouteCacheStats {
+  uint32_t hits;
+  uint32_t misses;
+  uint32_t evictions;
+  uint32_t prefetches;  // routes loaded by the background task
+};
+
+/**
+ * @brief Bounded LRU cache of RouteDetails in front of FileManager
+ *
+ * Cached details keep their strings in PSRAM (see FileManager). A background
+ * task fills the cache on prefetch() so the route is usually resident by the
+ * time it is applied.
+ */
+class RouteCache {
+public:
+  RouteCache(FileManager &fileManager);
+
+  /**
+   * @brief Create the lock and start the prefetch task
+   */
+  bool begin();
+
+  /**
+   * @brief Look up a route, reading it through FileManager on a miss
+   * @param type 0 for bus, 1 for tram
+   */
+  bool get(const char *id, int type, RouteDetails &details);
+
+  /**
+   * @brief Queue a route to be loaded in the background (non-blocking)
+   */
+  void prefetch(const char *id, int type);
+
+  /**
+   * @brief Hit/miss counts cover get() only, prefetches are counted apart
+   */
+  RouteCacheStats stats();
+
+private:
+  struct Slot {
+    bool used = false;
+    int type = 0;
+    uint32_t lastUse = 0;
+    RouteDetails details;
+  };
+
+  struct PrefetchRequest {
+    char id[48];
+    int type;
+  };
+
+  FileManager &_fileManager;
+  Slot _slots[ROUTE_CACHE_SIZE];
+  uint32_t _clock = 0;
+  RouteCacheStats _stats = {};
+
+  SemaphoreHandle_t _lock = nullptr;
+  QueueHandle_t _prefetchQueue = nullptr;
+
+  bool fetch(const char *id, int type, RouteDetails &details, bool background);
+  static void prefetchTask(void *arg);
+};
@@ -0,0 +1,141 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Binary route catalog (catalog.bin), produced by the desktop exporter.
+ *
+ * Layout (all integers little-endian):
+ *
+ *   CatalogHeader
+ *   uint32_t offsets[routeCount + 1]      absolute offset of every record,
+ *                                         the last entry marks the end
+ *   CatalogLookupEntry lookup[routeCount] sorted by idHash
+ *   records...                            CatalogRecord + strings
+ *
+ * Buses are stored first, trams follow. Every string is stored with a
+ * trailing NUL so it can be used in place; the lengths exclude it.
+ *
+ * After the strings every record carries its IBIS telegrams (line, then
+ * destination) fully framed with CR and parity, ready to be sent as is.
+ */
+
+#define CATALOG_MAGIC 0x4352544FUL  // "OTRC"
+#define CATALOG_VERSION 2
+
+// Data subtype of the "catalog" partition in partitions.csv
+#define CATALOG_PARTITION_SUBTYPE 0x40
+
+enum CatalogRouteType : uint8_t {
+  CATALOG_ROUTE_BUS = 0,
+  CATALOG_ROUTE_TRAM = 1,
+};
+
+struct __attribute__((packed)) CatalogHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t routeCount;
+  uint32_t busCount;
+  uint32_t offsetTable;
+  uint32_t lookupTable;
+  uint32_t fileSize;
+  uint32_t reserved;
+};
+
+struct __attribute__((packed)) CatalogLookupEntry {
+  uint32_t idHash;
+  uint32_t index;
+};
+
+struct __attribute__((packed)) CatalogRecord {
+  uint16_t ibisLine;
+  uint16_t ibisDestination;
+  uint8_t type;
+  uint8_t idLen;
+  uint8_t nameLen;
+  uint8_t binFileLen;
+  uint16_t textLen;
+  uint8_t ibisLen;
+  // followed by: id\0 name\0 alfaSignText\0 alfaSignBinFile\0 ibis[ibisLen]
+};
+
+static_assert(sizeof(CatalogHeader) == 32, "CatalogHeader layout changed");
+static_assert(sizeof(CatalogLookupEntry) == 8, "lookup layout changed");
+static_assert(sizeof(CatalogRecord) == 11, "CatalogRecord layout changed");
+
+/**
+ * @brief FNV-1a hash used for the id lookup table (must match the exporter)
+ */
+inline uint32_t catalogHash(const char *str, size_t len) {
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (uint8_t)str[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+/**
+ * @brief Pointers to the strings that follow a record in memory
+ */
+inline const char *catalogRecordId(const CatalogRecord *rec) {
+  return (const char *)(rec + 1);
+}
+
+inline const char *catalogRecordName(const CatalogRecord *rec) {
+  return catalogRecordId(rec) + rec->idLen + 1;
+}
+
+inline const char *catalogRecordText(const CatalogRecord *rec) {
+  return catalogRecordName(rec) + rec->nameLen + 1;
+}
+
+inline const char *catalogRecordBinFile(const CatalogRecord *rec) {
+  return catalogRecordText(rec) + rec->textLen + 1;
+}
+
+/**
+ * @brief Precompiled IBIS frames, `ibisLen` bytes
+ */
+inline const uint8_t *catalogRecordIbis(const CatalogRecord *rec) {
+  return (const uint8_t *)catalogRecordBinFile(rec) + rec->binFileLen + 1;
+}
+
+/**
+ * @brief Bytes a record occupies including its strings and terminators
+ */
+inline size_t catalogRecordSize(const CatalogRecord *rec) {
+  return sizeof(CatalogRecord) + rec->idLen + rec->nameLen + rec->textLen +
+         rec->binFileLen + 4 + rec->ibisLen;
+}
+
+/**
+ * @brief Check that a record and its terminated strings fit in `size` bytes
+ */
+inline bool catalogRecordValid(const CatalogRecord *rec, size_t size) {
+  if (size < sizeof(CatalogRecord) || catalogRecordSize(rec) > size)
+    return false;
+  return catalogRecordId(rec)[rec->idLen] == '\0' &&
+         catalogRecordName(rec)[rec->nameLen] == '\0' &&
+         catalogRecordText(rec)[rec->textLen] == '\0' &&
+         catalogRecordBinFile(rec)[rec->binFileLen] == '\0';
+}
+
+/**
+ * @brief Binary search of the lookup table for the first entry with `hash`
+ * @return Position in the lookup table, or `count` if not present
+ */
+inline uint32_t catalogLowerBound(const CatalogLookupEntry *lookup,
+                                  uint32_t count,
+                                  uint32_t hash) {
+  uint32_t lo = 0, hi = count;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (lookup[mid].idHash < hash)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return (lo < count && lookup[lo].idHash == hash) ? lo : count;
+}
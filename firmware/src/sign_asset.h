@@ -0,0 +1,105 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/*
+ * Sign bitmap asset (.sbm), produced by the desktop exporter through
+ * alfa-bus-protocol/exporter_bridge.py.
+ *
+ * Layout (all integers little-endian):
+ *
+ *   SignAssetHeader
+ *   SignAssetEntry entries[imageCount]   one per sign geometry
+ *   image data...
+ *
+ * Every image is the route's sign content for one width x height, stored
+ * row-major at 1 bit per pixel: rows of (width + 7) / 8 bytes, MSB
+ * leftmost, 1 = dot on. The rows are PackBits-compressed. Nothing in it
+ * is specific to a protocol or address; the firmware frames it for the
+ * sign it is sent to.
+ */
+
+#define SIGN_ASSET_MAGIC 0x4253544FUL  // "OTSB"
+#define SIGN_ASSET_VERSION 1
+#define SIGN_ASSET_EXTENSION ".sbm"
+
+struct __attribute__((packed)) SignAssetHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t imageCount;
+  uint16_t reserved;
+};
+
+struct __attribute__((packed)) SignAssetEntry {
+  uint16_t width;
+  uint16_t height;
+  uint32_t offset;  // from the start of the file
+  uint32_t length;  // compressed bytes
+};
+
+static_assert(sizeof(SignAssetHeader) == 8, "SignAssetHeader layout changed");
+static_assert(sizeof(SignAssetEntry) == 12, "SignAssetEntry layout changed");
+
+/**
+ * @brief Find the compressed image for a sign geometry in an asset file
+ * @param strip Look for a strip instead: an image of the sign's height but
+ * wider than `width`, exported for content that does not fit
+ * @return false if the file is invalid or has no such image
+ */
+inline bool signAssetFind(const uint8_t *file,
+                          size_t len,
+                          uint16_t width,
+                          uint16_t height,
+                          SignAssetEntry &found,
+                          bool strip = false) {
+  SignAssetHeader header;
+  if (len < sizeof(header)) return false;
+  memcpy(&header, file, sizeof(header));
+  if (header.magic != SIGN_ASSET_MAGIC ||
+      header.version != SIGN_ASSET_VERSION ||
+      len < sizeof(header) + header.imageCount * sizeof(SignAssetEntry)) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < header.imageCount; i++) {
+    SignAssetEntry entry;
+    memcpy(&entry, file + sizeof(header) + i * sizeof(entry), sizeof(entry));
+    bool match = strip ? entry.width > width : entry.width == width;
+    if (!match || entry.height != height) continue;
+    if (entry.offset > len || entry.length > len - entry.offset) return false;
+    found = entry;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Expand PackBits data into exactly `capacity` bytes
+ *
+ * A header byte n of 0-127 copies the next n + 1 bytes, 129-255 repeats
+ * the next byte 257 - n times, 128 is a no-op.
+ * @return false if the data is truncated or does not fill `out` exactly
+ */
+inline bool packBitsDecode(const uint8_t *src,
+                           size_t len,
+                           uint8_t *out,
+                           size_t capacity) {
+  size_t in = 0, pos = 0;
+  while (in < len) {
+    uint8_t n = src[in++];
+    if (n < 128) {
+      size_t count = n + 1;
+      if (count > len - in || count > capacity - pos) return false;
+      memcpy(out + pos, src + in, count);
+      in += count;
+      pos += count;
+    } else if (n > 128) {
+      size_t count = 257 - n;
+      if (in >= len || count > capacity - pos) return false;
+      memset(out + pos, src[in++], count);
+      pos += count;
+    }
+  }
+  return pos == capacity;
+}
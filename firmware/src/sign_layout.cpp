@@ -0,0 +1,172 @@
+#include "sign_layout.h"
+#include <esp_heap_caps.h>
+#include "mono_window.h"
+
+static uint8_t *allocImage(size_t bytes) {
+  uint8_t *data = (uint8_t *)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+  if (!data) data = (uint8_t *)heap_caps_malloc(bytes, MALLOC_CAP_DEFAULT);
+  if (data) memset(data, 0, bytes);
+  return data;
+}
+
+SignLayout::SignLayout(MonoLink &link, FlipdotSender &flipdot)
+    : _link(link), _flipdot(flipdot), _encoder(link) {}
+
+SignLayout::~SignLayout() {
+  for (size_t i = 0; i < _count; i++) {
+    heap_caps_free(_images[i].data);
+    heap_caps_free(_ledShown[i]);
+  }
+  heap_caps_free(_canvas.data);
+}
+
+bool SignLayout::begin(const MonoPanel *panels, size_t count) {
+  if (count == 0 || count > SIGN_LAYOUT_MAX_PANELS) return false;
+
+  uint16_t width = 0, height = 0;
+  for (size_t i = 0; i < count; i++) {
+    const MonoPanel &panel = panels[i];
+    if (panel.width == 0 || panel.height == 0) return false;
+    width = max(width, (uint16_t)(panel.x + panel.width));
+    height = max(height, (uint16_t)(panel.y + panel.height));
+  }
+
+  uint8_t *canvas = allocImage(MonoBitmap::bytesFor(width, height));
+  if (!canvas) return false;
+  _canvas = MonoBitmap(width, height, canvas);
+  for (size_t i = 0; i < count; i++) {
+    const MonoPanel &panel = panels[i];
+    size_t bytes = MonoBitmap::bytesFor(panel.width, panel.height);
+    uint8_t *data = allocImage(bytes);
+    uint8_t *shown = panel.type == MONO_SIGN_LED ? allocImage(bytes) : nullptr;
+    _count = i;
+    if (!data || (panel.type == MONO_SIGN_LED && !shown)) {
+      heap_caps_free(data);
+      heap_caps_free(shown);
+      return false;
+    }
+    _panels[i] = panel;
+    _images[i] = MonoBitmap(panel.width, panel.height, data);
+    _ledShown[i] = shown;
+  }
+  _count = count;
+
+  Serial.printf("Sign layout: %u panels, canvas %ux%u\n", (unsigned)count,
+                width, height);
+  return true;
+}
+
+FrameKey SignLayout::key() const {
+  FrameKey key;
+  for (size_t i = 0; i < _count; i++) {
+    const MonoPanel &panel = _panels[i];
+    key.add((uint32_t)panel.type << 16 | panel.address << 8 |
+            panel.columnOffset)
+        .add((uint32_t)panel.width << 16 | panel.height)
+        .add((uint32_t)panel.x << 16 | panel.y);
+  }
+  return key;
+}
+
+const MonoBitmap &SignLayout::slice(size_t index) {
+  const MonoPanel &panel = _panels[index];
+  monoCopyWindow(_canvas, panel.x, panel.y, _images[index]);
+  return _images[index];
+}
+
+size_t SignLayout::fullBound(const MonoPanel &panel) {
+  if (panel.type == MONO_SIGN_FLIPDOT) {
+    // Set-up frame plus one column frame per column, all escaped
+    size_t columnMax = 2 * ((panel.height + 3) / 4 + 4) + 2;
+    return 20 + panel.width * columnMax;
+  }
+  // Set-up, bitmap and display frames
+  return 3 * MONO_FRAME_MAX;
+}
+
+size_t SignLayout::encodeFull(size_t index, uint8_t *out, size_t capacity) {
+  const MonoPanel &panel = _panels[index];
+  const MonoBitmap &image = _images[index];
+  if (panel.type == MONO_SIGN_FLIPDOT) {
+    size_t len = FlipdotSender::encodeFull(panel.address, image,
+                                           panel.columnOffset, out, capacity);
+    return len <= capacity ? len : 0;
+  }
+  BufferTransport buffer(out, capacity);
+  MonoEncoder<BufferTransport> encoder(buffer);
+  size_t len = encoder.ledImage(panel.address, image);
+  return buffer.overflowed() ? 0 : len;
+}
+
+size_t SignLayout::send(size_t index, ByteSpan full) {
+  const MonoPanel &panel = _panels[index];
+  if (panel.type == MONO_SIGN_FLIPDOT) {
+    return _flipdot.send(panel.address, _images[index], panel.columnOffset,
+                         full);
+  }
+  return sendLed(index, full);
+}
+
+size_t SignLayout::sendLed(size_t index, ByteSpan full) {
+  const MonoPanel &panel = _panels[index];
+  const MonoBitmap &image = _images[index];
+  if (!_link.present(panel.address)) return 0;
+
+  portENTER_CRITICAL(&_mux);
+  bool valid = _ledValid[index];
+  uint32_t epoch = _ledEpoch[index];
+  portEXIT_CRITICAL(&_mux);
+  if (valid && memcmp(_ledShown[index], image.data, image.bytes()) == 0) {
+    return 0;
+  }
+
+  // LED signs take only whole bitmaps; the set-up frames describe the
+  // size, which does not change between frames of the same panel
+  size_t sent;
+  if (valid) {
+    sent = _encoder.ledBitmap(panel.address, image);
+    if (sent) sent += _encoder.ledDisplay(panel.address);
+  } else if (full.size) {
+    sent = _link.writeFrames(full);
+  } else {
+    sent = _encoder.ledImage(panel.address, image);
+  }
+  if (!sent) {
+    // LED bitmaps are limited to 255 bytes
+    Serial.printf("Alfa: cannot encode a %ux%u LED image\n", image.width,
+                  image.height);
+    return 0;
+  }
+
+  memcpy(_ledShown[index], image.data, image.bytes());
+  portENTER_CRITICAL(&_mux);
+  if (_ledEpoch[index] == epoch) _ledValid[index] = true;
+  portEXIT_CRITICAL(&_mux);
+  return sent;
+}
+
+void SignLayout::invalidate() {
+  _flipdot.invalidateAll();
+  portENTER_CRITICAL(&_mux);
+  for (size_t i = 0; i < _count; i++) {
+    _ledValid[i] = false;
+    _ledEpoch[i]++;
+  }
+  portEXIT_CRITICAL(&_mux);
+}
+
+void SignLayout::on_link_reply(void *ctx,
+                               uint8_t command,
+                               uint8_t address,
+                               const uint8_t *reply,
+                               size_t len) {
+  if (reply) return;
+  SignLayout *layout = (SignLayout *)ctx;
+  portENTER_CRITICAL(&layout->_mux);
+  for (size_t i = 0; i < layout->_count; i++) {
+    if (layout->_panels[i].address != address) continue;
+    layout->_ledValid[i] = false;
+    layout->_ledEpoch[i]++;
+  }
+  portEXIT_CRITICAL(&layout->_mux);
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <Arduino.h>
+#include "flipdot_sender.h"
+#include "frame_cache.h"
+#include "mono_encoder.h"
+#include "mono_link.h"
+
+#ifndef SIGN_LAYOUT_MAX_PANELS
+#define SIGN_LAYOUT_MAX_PANELS 8
+#endif
+
+/**
+ * @brief One MONO display and the part of the canvas it shows
+ */
+struct MonoPanel {
+  MonoSignType type;
+  uint8_t address;
+  uint16_t width;
+  uint16_t height;
+  uint16_t x;  // top left corner on the canvas
+  uint16_t y;
+  uint8_t columnOffset;  // flipdot: address of the leftmost column
+};
+
+/**
+ * @brief Several MONO panels driven as one virtual canvas
+ *
+ * The canvas is the bounding box of the panel map. Content is drawn once
+ * onto it, then every panel gets its slice encoded for its own sign type
+ * and queued on the link. The link sends on its own task, so a panel is
+ * being transmitted while the next one is sliced and encoded, and panels
+ * at different addresses share the bus while each waits out its busy
+ * time. A single sign is a layout with one panel.
+ */
+class SignLayout {
+public:
+  SignLayout(MonoLink &link, FlipdotSender &flipdot);
+  ~SignLayout();
+
+  /**
+   * @brief Take the panel map and allocate the canvas and panel images
+   * @return false if the map is empty, too long or out of memory
+   */
+  bool begin(const MonoPanel *panels, size_t count);
+
+  MonoBitmap &canvas() { return _canvas; }
+  size_t panelCount() const { return _count; }
+  const MonoPanel &panel(size_t index) const { return _panels[index]; }
+
+  /**
+   * @brief FrameKey over the panel map; callers add the content
+   */
+  FrameKey key() const;
+
+  /**
+   * @brief Copy panel `index`'s part of the canvas into its image
+   */
+  const MonoBitmap &slice(size_t index);
+
+  /**
+   * @brief Upper bound of encodeFull() for a panel
+   */
+  static size_t fullBound(const MonoPanel &panel);
+
+  /**
+   * @brief Encode a full update of the sliced panel into `out`
+   * @return Bytes written, 0 if it does not fit or cannot be encoded
+   */
+  size_t encodeFull(size_t index, uint8_t *out, size_t capacity);
+
+  /**
+   * @brief Queue the sliced panel on the link
+   *
+   * Flipdot panels flip only the dots that change. LED panels are skipped
+   * when their slice is unchanged, and after a first full update get only
+   * the bitmap and display frames.
+   * @param full Its full update from encodeFull(), if at hand
+   * @return Bytes queued, 0 if nothing had to change or on error
+   */
+  size_t send(size_t index, ByteSpan full = ByteSpan{nullptr, 0});
+
+  bool waitSent(uint32_t timeoutMs) { return _link.waitIdle(timeoutMs); }
+
+  /**
+   * @brief What the panels show is unknown (e.g. after a replay)
+   */
+  void invalidate();
+
+  /**
+   * @brief MonoLink::ReplyCallback, ctx is the SignLayout; an LED panel
+   * that did not answer gets a full update next time
+   */
+  static void on_link_reply(void *ctx,
+                            uint8_t command,
+                            uint8_t address,
+                            const uint8_t *reply,
+                            size_t len);
+
+private:
+  MonoLink &_link;
+  FlipdotSender &_flipdot;
+  MonoEncoder<MonoLink> _encoder;
+  MonoPanel _panels[SIGN_LAYOUT_MAX_PANELS];
+  MonoBitmap _images[SIGN_LAYOUT_MAX_PANELS];
+  size_t _count = 0;
+  MonoBitmap _canvas;
+
+  // Last image sent to each LED panel; an invalidate() during a send bumps
+  // the epoch so the send does not mark it valid again
+  uint8_t *_ledShown[SIGN_LAYOUT_MAX_PANELS] = {};
+  bool _ledValid[SIGN_LAYOUT_MAX_PANELS] = {};
+  uint32_t _ledEpoch[SIGN_LAYOUT_MAX_PANELS] = {};
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+
+  size_t sendLed(size_t index, ByteSpan full);
+};
@@ -0,0 +1,46 @@
+#include "sign_marquee.h"
+#include <esp_heap_caps.h>
+#include "mono_window.h"
+
+SignMarquee::~SignMarquee() { heap_caps_free(_strip.data); }
+
+MonoBitmap *SignMarquee::strip(uint16_t width, uint16_t height) {
+  _active = false;
+  size_t bytes = MonoBitmap::bytesFor(width, height);
+  if (bytes > _capacity) {
+    heap_caps_free(_strip.data);
+    _capacity = 0;
+    uint8_t *data = (uint8_t *)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM);
+    if (!data) data = (uint8_t *)heap_caps_malloc(bytes, MALLOC_CAP_DEFAULT);
+    _strip.data = data;
+    if (!data) return nullptr;
+    _capacity = bytes;
+  }
+  _strip.width = width;
+  _strip.height = height;
+  _strip.clear();
+  return &_strip;
+}
+
+void SignMarquee::start(MarqueeMode mode, uint16_t window) {
+  _mode = mode;
+  _offset = 0;
+  if (mode == MARQUEE_PAGE) {
+    _cycle = _strip.width;
+    _step = window;
+  } else {
+    _cycle = _strip.width + MARQUEE_SCROLL_GAP_PX;
+    _step = MARQUEE_SCROLL_STEP_PX;
+  }
+  _active = mode != MARQUEE_CROP && _strip.data && _strip.width > window;
+}
+
+uint32_t SignMarquee::interval() const {
+  return _mode == MARQUEE_PAGE ? MARQUEE_PAGE_MS : MARQUEE_SCROLL_STEP_MS;
+}
+
+void SignMarquee::frame(MonoBitmap &canvas) {
+  if (!_strip.data || canvas.height != _strip.height) return;
+  monoCopyColumnsWrapped(_strip, _offset, _cycle, canvas);
+  if (_active) _offset = (_offset + _step) % _cycle;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <Arduino.h>
+#include "mono_bitmap.h"
+
+// Scrolling: pixels per step, time per step and the blank gap between the
+// end of the content and its start coming round again
+#ifndef MARQUEE_SCROLL_STEP_PX
+#define MARQUEE_SCROLL_STEP_PX 2
+#endif
+#ifndef MARQUEE_SCROLL_STEP_MS
+#define MARQUEE_SCROLL_STEP_MS 100
+#endif
+#ifndef MARQUEE_SCROLL_GAP_PX
+#define MARQUEE_SCROLL_GAP_PX 32
+#endif
+
+// Paging: time each page is shown
+#ifndef MARQUEE_PAGE_MS
+#define MARQUEE_PAGE_MS 3000
+#endif
+
+// Percentage of the bus time animation may take. A 112x16 LED frame is
+// about 130 ms on the wire at 19200 baud, so frames are spaced out to
+// leave the rest to other addresses, queries and retries.
+#ifndef MARQUEE_BUS_SHARE
+#define MARQUEE_BUS_SHARE 75
+#endif
+
+enum MarqueeMode : uint8_t {
+  MARQUEE_CROP,    // show the start, cut off the rest
+  MARQUEE_SCROLL,  // move left a few pixels per step, wrapping around
+  MARQUEE_PAGE,    // show one canvas-wide page at a time
+};
+
+/**
+ * @brief Content wider than the sign, shown one window at a time
+ *
+ * The content is drawn once onto a strip. Every frame copies the window
+ * at the current offset onto the canvas; bitmaps are column-major, so
+ * that is a copy of whole columns. Used by the I/O worker task only.
+ */
+class SignMarquee {
+public:
+  ~SignMarquee();
+
+  /**
+   * @brief Stop animating and return a cleared strip to draw on
+   * @return nullptr if out of memory
+   */
+  MonoBitmap *strip(uint16_t width, uint16_t height);
+
+  /**
+   * @brief Animate the strip on canvases `window` columns wide
+   *
+   * For paging the strip must hold whole pages of `window` columns.
+   */
+  void start(MarqueeMode mode, uint16_t window);
+  void stop() { _active = false; }
+  bool active() const { return _active; }
+
+  /**
+   * @brief Time from one frame to the next
+   */
+  uint32_t interval() const;
+
+  /**
+   * @brief Copy the current window onto `canvas` and advance
+   */
+  void frame(MonoBitmap &canvas);
+
+private:
+  MonoBitmap _strip;
+  size_t _capacity = 0;
+  MarqueeMode _mode = MARQUEE_CROP;
+  bool _active = false;
+  uint32_t _offset = 0;
+  uint32_t _cycle = 0;  // columns until the window is back at the start
+  uint16_t _step = 0;
+};
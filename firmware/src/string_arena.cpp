@@ -0,0 +1,85 @@
+#include "string_arena.h"
+#include <esp_heap_caps.h>
+#include "route_catalog.h"
+
+StringArena::~StringArena() {
+  if (_owned) heap_caps_free(_owned);
+}
+
+void StringArena::attach(const char *base) {
+  if (_owned) heap_caps_free(_owned);
+  _owned = nullptr;
+  _base = base;
+  _attached = true;
+  _size = 0;
+  _capacity = 0;
+  _slots.clear();
+  _used = 0;
+}
+
+bool StringArena::resize(size_t capacity) {
+  // Keep the strings out of the internal heap LVGL allocates from
+  void *grown = heap_caps_realloc(_owned, capacity, MALLOC_CAP_SPIRAM);
+  if (!grown) grown = heap_caps_realloc(_owned, capacity, MALLOC_CAP_DEFAULT);
+  if (!grown) return false;
+
+  _owned = (char *)grown;
+  _base = _owned;
+  _capacity = capacity;
+  return true;
+}
+
+size_t StringArena::probe(const char *str, size_t len, uint32_t hash) const {
+  size_t mask = _slots.size() - 1;
+  for (size_t i = hash & mask;; i = (i + 1) & mask) {
+    uint32_t slot = _slots[i];
+    if (slot == 0) return i;
+    const char *existing = _owned + slot - 1;
+    if (strncmp(existing, str, len) == 0 && existing[len] == '\0') return i;
+  }
+}
+
+void StringArena::rehash(size_t slots) {
+  std::vector<uint32_t> old;
+  old.swap(_slots);
+  _slots.assign(slots, 0);
+  for (uint32_t slot : old) {
+    if (slot == 0) continue;
+    const char *str = _owned + slot - 1;
+    size_t len = strlen(str);
+    _slots[probe(str, len, catalogHash(str, len))] = slot;
+  }
+}
+
+uint32_t StringArena::intern(const char *str, size_t len) {
+  if (_attached) return npos;
+
+  // Keep the table at most half full
+  if ((_used + 1) * 2 > _slots.size()) {
+    rehash(_slots.empty() ? 64 : _slots.size() * 2);
+  }
+
+  uint32_t hash = catalogHash(str, len);
+  size_t index = probe(str, len, hash);
+  if (_slots[index] != 0) return _slots[index] - 1;
+
+  if (_size + len + 1 > _capacity &&
+      !resize(std::max(_capacity * 2, _size + len + 1 + 1024))) {
+    return npos;
+  }
+
+  uint32_t offset = _size;
+  memcpy(_owned + offset, str, len);
+  _owned[offset + len] = '\0';
+  _size += len + 1;
+
+  _slots[index] = offset + 1;
+  _used++;
+  return offset;
+}
+
+void StringArena::seal() {
+  std::vector<uint32_t>().swap(_slots);
+  _used = 0;
+  if (_owned && _size < _capacity) resize(_size);
+}
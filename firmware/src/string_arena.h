@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <vector>
+
+/**
+ * @brief One contiguous block of NUL-terminated strings addressed by offset
+ *
+ * Owned arenas live in PSRAM when available and deduplicate identical
+ * strings while they are being filled. Since callers hold offsets rather
+ * than pointers the block can be reallocated as it grows. An arena can also
+ * be attached to read-only memory such as the mapped catalog partition, in
+ * which case offsets are relative to that memory and nothing is copied.
+ */
+class StringArena {
+public:
+  static const uint32_t npos = UINT32_MAX;
+
+  StringArena() = default;
+  ~StringArena();
+  StringArena(const StringArena &) = delete;
+  StringArena &operator=(const StringArena &) = delete;
+
+  /**
+   * @brief Use external read-only memory as the arena (no copy, no interning)
+   */
+  void attach(const char *base);
+
+  /**
+   * @brief Store a string once and return its offset
+   * @return Offset of the (possibly existing) copy, or npos if out of memory
+   */
+  uint32_t intern(const char *str, size_t len);
+
+  /**
+   * @brief Finish filling: trim the block and free the dedup table
+   */
+  void seal();
+
+  const char *at(uint32_t offset) const { return _base + offset; }
+  size_t size() const { return _size; }
+
+private:
+  const char *_base = "";
+  char *_owned = nullptr;
+  bool _attached = false;
+  size_t _size = 0;
+  size_t _capacity = 0;
+
+  // Open-addressed set of offset + 1 (0 = empty), only while filling
+  std::vector<uint32_t> _slots;
+  size_t _used = 0;
+
+  bool resize(size_t capacity);
+  void rehash(size_t slots);
+  size_t probe(const char *str, size_t len, uint32_t hash) const;
+};
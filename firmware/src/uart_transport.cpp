@@ -0,0 +1,146 @@
+#include "uart_transport.h"
+
+UartTransport::UartTransport(uart_port_t port) : _port(port) {}
+
+bool UartTransport::begin(uint32_t baud,
+                          uint32_t config,
+                          int8_t rxPin,
+                          int8_t txPin,
+                          size_t txBuffer,
+                          size_t rxBuffer) {
+  if (_events) return true;
+
+  // Same bit layout as the Arduino SERIAL_xxx constants
+  uart_config_t uartConfig = {};
+  uartConfig.baud_rate = baud;
+  uartConfig.data_bits = (uart_word_length_t)((config & 0xC) >> 2);
+  uartConfig.parity = (uart_parity_t)(config & 0x3);
+  uartConfig.stop_bits = (uart_stop_bits_t)((config & 0x30) >> 4);
+  uartConfig.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+  uartConfig.source_clk = UART_SCLK_DEFAULT;
+
+  esp_err_t err = uart_driver_install(_port, rxBuffer, txBuffer, 16, &_events,
+                                      0);
+  if (err == ESP_OK) err = uart_param_config(_port, &uartConfig);
+  if (err == ESP_OK) {
+    err = uart_set_pin(_port, txPin < 0 ? UART_PIN_NO_CHANGE : txPin,
+                       rxPin < 0 ? UART_PIN_NO_CHANGE : rxPin,
+                       UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  }
+  if (err == ESP_OK) {
+    err = uart_set_rx_timeout(_port, UART_TRANSPORT_RX_IDLE_SYMBOLS);
+  }
+  if (err != ESP_OK) {
+    Serial.printf("UART%d: driver setup failed: %s\n", (int)_port,
+                  esp_err_to_name(err));
+    if (uart_is_driver_installed(_port)) uart_driver_delete(_port);
+    _events = nullptr;
+    return false;
+  }
+  _txBuffer = txBuffer;
+
+  return xTaskCreatePinnedToCore(eventTask, "uart_events", 2048, this, 4,
+                                 nullptr, ARDUINO_RUNNING_CORE ? 0 : 1) ==
+         pdPASS;
+}
+
+bool UartTransport::submit(const uint8_t *data, size_t len) {
+  size_t free = 0;
+  if (!_events || uart_get_tx_buffer_free_size(_port, &free) != ESP_OK ||
+      free < len) {
+    portENTER_CRITICAL(&_mux);
+    _stats.rejected++;
+    portEXIT_CRITICAL(&_mux);
+    return false;
+  }
+  // Fits the ring, so the driver copies it and returns at once
+  return write(data, len) == len;
+}
+
+size_t UartTransport::write(const uint8_t *data, size_t len) {
+  if (!_events) return 0;
+  int written = uart_write_bytes(_port, data, len);
+  if (written <= 0) return 0;
+  portENTER_CRITICAL(&_mux);
+  _stats.submitted += written;
+  portEXIT_CRITICAL(&_mux);
+  return written;
+}
+
+bool UartTransport::waitTxDone(uint32_t timeoutMs) {
+  if (!_events) return true;
+  return uart_wait_tx_done(_port, pdMS_TO_TICKS(timeoutMs)) == ESP_OK;
+}
+
+size_t UartTransport::txPending() {
+  size_t free = 0;
+  if (!_events || uart_get_tx_buffer_free_size(_port, &free) != ESP_OK) {
+    return 0;
+  }
+  return free < _txBuffer ? _txBuffer - free : 0;
+}
+
+size_t UartTransport::read(uint8_t *buf, size_t len, uint32_t timeoutMs) {
+  if (!_events) return 0;
+  int got = uart_read_bytes(_port, buf, len, pdMS_TO_TICKS(timeoutMs));
+  return got > 0 ? got : 0;
+}
+
+size_t UartTransport::available() {
+  size_t len = 0;
+  if (_events) uart_get_buffered_data_len(_port, &len);
+  return len;
+}
+
+void UartTransport::onRxFrame(RxFrameCallback callback, void *ctx) {
+  _rxCallbackCtx = ctx;
+  _rxCallback = callback;
+}
+
+UartTransportStats UartTransport::stats() {
+  portENTER_CRITICAL(&_mux);
+  UartTransportStats copy = _stats;
+  portEXIT_CRITICAL(&_mux);
+  return copy;
+}
+
+void UartTransport::eventTask(void *arg) {
+  UartTransport *uart = (UartTransport *)arg;
+  uart_event_t event;
+
+  while (true) {
+    if (xQueueReceive(uart->_events, &event, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    portENTER_CRITICAL(&uart->_mux);
+    switch (event.type) {
+    case UART_DATA:
+      if (event.timeout_flag) uart->_stats.rxFrames++;
+      break;
+    case UART_BREAK:
+      uart->_stats.breaks++;
+      break;
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+      uart->_stats.rxOverflows++;
+      break;
+    case UART_PARITY_ERR:
+    case UART_FRAME_ERR:
+      uart->_stats.rxErrors++;
+      break;
+    default:
+      break;
+    }
+    portEXIT_CRITICAL(&uart->_mux);
+
+    if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+      // The driver stops receiving until the input is drained
+      uart_flush_input(uart->_port);
+      xQueueReset(uart->_events);
+    } else if (event.type == UART_DATA && event.timeout_flag &&
+               uart->_rxCallback) {
+      uart->_rxCallback(uart->_rxCallbackCtx);
+    }
+  }
+}
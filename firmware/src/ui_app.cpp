@@ -1,14 +1,15 @@
 #include "ui_app.h"
+#include "lvgl_v8_port.h"
 
 #define FONT_SMALL &Montserrat
 #define FONT_LARGE &Montserrat
 
-void UIApp::init(FileManager *fileManager,
-                 IndexData *indexData,
-                 IbisProtocol *ibis) {
-  _fileManager = fileManager;
+void UIApp::init(RouteCache *routeCache,
+                 IoWorker *worker,
+                 IndexData *indexData) {
+  _routeCache = routeCache;
+  _worker = worker;
   _indexData = indexData;
-  _ibis = ibis;
 
   lv_obj_t *tabview = lv_tabview_create(lv_scr_act(), LV_DIR_TOP, 50);
 
@@ -37,13 +38,20 @@ void UIApp::create_route_tab(lv_obj_t *parent, bool isTram) {
   lv_obj_t *list = lv_list_create(parent);
   lv_obj_set_size(list, lv_pct(45), lv_pct(100));
   lv_obj_align(list, LV_ALIGN_TOP_LEFT, 0, 0);
+  (isTram ? _tram_list : _bus_list) = list;
 
   const std::vector<RouteEntry> &routes =
       isTram ? _indexData->trams : _indexData->buses;
 
   for (const auto &route : routes) {
-    lv_obj_t *btn = lv_list_add_btn(list, NULL, route.name.c_str());
+    // Same layout lv_list_add_btn builds for a text, but the label points at
+    // the name in IndexData::strings instead of copying it
+    lv_obj_t *btn = lv_list_add_btn(list, NULL, NULL);
     lv_obj_set_style_text_font(btn, FONT_SMALL, 0);
+    lv_obj_t *btn_label = lv_label_create(btn);
+    lv_label_set_text_static(btn_label, _indexData->name(route));
+    lv_label_set_long_mode(btn_label, LV_LABEL_LONG_SCROLL_CIRCULAR);
+    lv_obj_set_flex_grow(btn_label, 1);
 
     // Store metadata (file/id) in user data or event?
     // We can attach a pointer to a struct, or just copy string to user_data if
@@ -126,7 +134,8 @@ void UIApp::list_btn_event_handler(lv_event_t *e) {
     }
   }
 
-  app->onRouteSelect(btn, isTram, route->file.c_str(), route->name.c_str());
+  app->onRouteSelect(btn, isTram, app->_indexData->file(*route),
+                     app->_indexData->name(*route));
 }
 
 void UIApp::onRouteSelect(lv_obj_t *btn,
@@ -134,17 +143,20 @@ void UIApp::onRouteSelect(lv_obj_t *btn,
                           const char *file_id,
                           const char *name) {
   if (isTram) {
-    _selected_tram_file = String(file_id);
-    _selected_tram_name = String(name);
+    _selected_tram_file = file_id;
+    _selected_tram_name = name;
     if (_last_tram_btn) lv_obj_clear_state(_last_tram_btn, LV_STATE_CHECKED);
     _last_tram_btn = btn;
   } else {
-    _selected_bus_file = String(file_id);
-    _selected_bus_name = String(name);
+    _selected_bus_file = file_id;
+    _selected_bus_name = name;
     if (_last_bus_btn) lv_obj_clear_state(_last_bus_btn, LV_STATE_CHECKED);
     _last_bus_btn = btn;
   }
   lv_obj_add_state(btn, LV_STATE_CHECKED);
+
+  // Load the details now so Apply usually finds them in the cache
+  _routeCache->prefetch(file_id, isTram ? 1 : 0);
 }
 
 void UIApp::apply_event_handler(lv_event_t *e) {
@@ -160,70 +172,92 @@ void UIApp::apply_event_handler(lv_event_t *e) {
 }
 
 void UIApp::onApply(bool isTram, lv_obj_t *dropdown) {
-  String selectedFile = isTram ? _selected_tram_file : _selected_bus_file;
-  String selectedName = isTram ? _selected_tram_name : _selected_bus_name;
+  const char *selectedFile = isTram ? _selected_tram_file : _selected_bus_file;
+  const char *selectedName = isTram ? _selected_tram_name : _selected_bus_name;
 
-  if (selectedFile.isEmpty()) {
+  if (!selectedFile) {
     Serial.println("No route selected!");
     return;
   }
 
-  RouteDetails details;
-  // Type: 0 for bus, 1 for tram
-  if (_fileManager->readRoute(selectedFile, details, isTram ? 1 : 0)) {
-    Serial.println("Parsing successful. Applying...");
-    uint16_t selectedOpt = lv_dropdown_get_selected(dropdown);
-    bool isIbis = (selectedOpt == 0);
-
-    if (isIbis) {
-      Serial.println("Sending IBIS commands...");
-      if (_ibis) {
-        // Parse line and dest as int, defaults to 0 if invalid
-        uint16_t line = details.ibisLineCmd.toInt();
-        uint16_t dest = details.ibisDestinationCmd.toInt();
-
-        // Send Line
-        _ibis->setLine(line);
-        delay(200);  // Small delay between commands often helps
-        // Send Destination
-        _ibis->setDestination(dest);
-        delay(200);
-        // Often sending text is useful too?
-        // _ibis->setText(details.alfaSignText);
-        Serial.printf("IBIS sent: Line %d, Dest %d\n", line, dest);
-      }
-    } else {
-      Serial.println("Sending Alfa Binary...");
-      // Read binary file content
-      String binPath =
-          (isTram ? "/trams/" : "/buses/") + details.alfaSignBinFile;
-
-      if (LittleFS.exists(binPath)) {
-        File binFile = LittleFS.open(binPath, "r");
-        if (binFile) {
-          Stream &alfaSerial = Serial1;
-
-          size_t sent = 0;
-          uint8_t buf[64];
-          while (binFile.available()) {
-            size_t len = binFile.read(buf, sizeof(buf));
-            alfaSerial.write(buf, len);
-            sent += len;
-          }
-          binFile.close();
-          Serial.printf("Alfa sent: %d bytes from %s\n", sent, binPath.c_str());
-        } else {
-          Serial.printf("Failed to open bin file: %s\n", binPath.c_str());
-        }
-      } else {
-        Serial.printf("Bin file not found: %s\n", binPath.c_str());
-      }
-    }
+  uint16_t selectedOpt = lv_dropdown_get_selected(dropdown);
+  bool isIbis = (selectedOpt == 0);
+
+  // Type: 0 for bus, 1 for tram. The worker does the I/O, this returns at
+  // once and the label is updated again from onProgress().
+  if (!_worker->submitApply(selectedFile, selectedName, isTram ? 1 : 0,
+                            isIbis)) {
+    Serial.println("Apply queue full");
+    return;
+  }
+
+  lv_label_set_text_fmt(_label_home_selected, "Надсилання...\n%s\n(%s)",
+                        selectedName, isIbis ? "IBIS" : "Alfa");
+}
+
+void UIApp::on_worker_progress(void *ctx) {
+  ((UIApp *)ctx)->onProgress();
+}
 
+void UIApp::onProgress() {
+  ApplyProgress progress = _worker->progress();
+  const char *sign = progress.ibis ? "IBIS" : "Alfa";
+
+  switch (progress.state) {
+  case ApplyProgress::RUNNING:
+    if (progress.total > 0) {
+      lv_label_set_text_fmt(_label_home_selected,
+                            "Надсилання... %u%%\n%s\n(%s)",
+                            (unsigned)(progress.sent * 100 / progress.total),
+                            progress.name, sign);
+    }
+    break;
+  case ApplyProgress::DONE:
     // Update Home Label
     lv_label_set_text_fmt(_label_home_selected, "Вибрано:\n%s\n(%s)",
-                          selectedName.c_str(), isIbis ? "IBIS" : "Alfa");
-  } else {
-    Serial.println("Failed to read route file");
+                          progress.name, sign);
+    break;
+  case ApplyProgress::FAILED:
+    lv_label_set_text_fmt(_label_home_selected, "Помилка:\n%s\n(%s)",
+                          progress.name, sign);
+    break;
+  default:
+    break;
+  }
+}
+
+void UIApp::on_ibis_route(const RouteEntry *entry, void *ctx) {
+  UIApp *app = (UIApp *)ctx;
+  app->_ibis_route = entry;
+
+  // lv_async_call is not thread-safe, so schedule it under the LVGL lock.
+  lvgl_port_lock(-1);
+  lv_async_call([](void *ctx) { ((UIApp *)ctx)->onIbisRoute(); }, app);
+  lvgl_port_unlock();
+}
+
+void UIApp::onIbisRoute() {
+  const RouteEntry *route = _ibis_route;
+  if (!route) return;
+  _ibis_route = nullptr;
+
+  const std::vector<RouteEntry> &trams = _indexData->trams;
+  bool isTram = route >= trams.data() && route < trams.data() + trams.size();
+  const std::vector<RouteEntry> &routes = isTram ? trams : _indexData->buses;
+  lv_obj_t *list = isTram ? _tram_list : _bus_list;
+
+  // The list buttons were created in index order
+  lv_obj_t *btn = lv_obj_get_child(list, route - routes.data());
+  if (!btn) return;
+  lv_obj_scroll_to_view(btn, LV_ANIM_OFF);
+
+  const char *file = _indexData->file(*route);
+  const char *name = _indexData->name(*route);
+  onRouteSelect(btn, isTram, file, name);
+
+  // The IBIS master keeps driving its own signs, follow it on the Alfa sign
+  if (_worker->submitApply(file, name, isTram ? 1 : 0, false)) {
+    lv_label_set_text_fmt(_label_home_selected, "Надсилання...\n%s\n(%s)",
+                          name, "Alfa");
   }
 }
@@ -2,31 +2,48 @@
 #include <Arduino.h>
 #include <lvgl.h>
 #include "file_manager.h"
-#include "ibis_protocol.h"
+#include "route_cache.h"
+#include "io_worker.h"
 
 // Declare the custom font
 LV_FONT_DECLARE(Montserrat);
 
 class UIApp {
 public:
-  void init(FileManager *fileManager, IndexData *indexData, IbisProtocol* ibis);
+  void init(RouteCache *routeCache, IoWorker *worker, IndexData *indexData);
+
+  /**
+   * @brief IoWorker progress callback, runs in the LVGL task
+   */
+  static void on_worker_progress(void *ctx);
+
+  /**
+   * @brief IbisReceiver route callback, runs on the receiver task
+   */
+  static void on_ibis_route(const RouteEntry *entry, void *ctx);
 
 private:
-  FileManager *_fileManager;
+  RouteCache *_routeCache;
+  IoWorker *_worker;
   IndexData *_indexData;
-  IbisProtocol *_ibis;
 
   lv_obj_t *_label_home_selected;
 
-  // State to track selection
-  String _selected_bus_file;
-  String _selected_tram_file;
-  String _selected_bus_name;
-  String _selected_tram_name;
+  // State to track selection, points into IndexData::strings
+  const char *_selected_bus_file = nullptr;
+  const char *_selected_tram_file = nullptr;
+  const char *_selected_bus_name = nullptr;
+  const char *_selected_tram_name = nullptr;
 
   lv_obj_t *_last_bus_btn = nullptr;
   lv_obj_t *_last_tram_btn = nullptr;
 
+  lv_obj_t *_bus_list = nullptr;
+  lv_obj_t *_tram_list = nullptr;
+
+  // Route picked up from the IBIS master, handed over to the LVGL task
+  const RouteEntry *volatile _ibis_route = nullptr;
+
   void create_home_tab(lv_obj_t *parent);
   void create_route_tab(lv_obj_t *parent, bool isTram);
 
@@ -38,4 +55,6 @@ private:
                      const char *file_id,
                      const char *name);
   void onApply(bool isTram, lv_obj_t *dropdown);
+  void onProgress();
+  void onIbisRoute();
 };
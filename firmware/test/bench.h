@@ -0,0 +1,39 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+/*
+ * Timing helpers for the benchmarks next to the unit tests. Results are
+ * printed, not asserted: they depend on the machine the tests run on.
+ */
+
+// Written by benchmarks so the compiler keeps the work being timed
+static volatile uint32_t benchSink;
+
+/**
+ * @brief Mean time of one call of `fn` over `runs` calls, in microseconds
+ */
+template <typename Fn>
+double benchMicros(size_t runs, Fn fn) {
+  fn();  // warm up caches and lazy allocations
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < runs; i++) fn();
+  std::chrono::duration<double, std::micro> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count() / runs;
+}
+
+inline void benchReport(const char *name, double micros) {
+  printf("bench: %-44s %10.2f us\n", name, micros);
+}
+
+inline void benchCompare(const char *name, double reference, double micros) {
+  printf("bench: %-44s %10.2f us -> %.2f us (%.1fx)\n", name, reference,
+         micros, micros > 0 ? reference / micros : 0.0);
+}
+
+#endif  // BENCH_H
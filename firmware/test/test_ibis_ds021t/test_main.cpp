@@ -0,0 +1,181 @@
+#include <unity.h>
+#include <string>
+#include "../bench.h"
+#include "ibis_ds021t.h"
+
+/*
+ * IbisDs021tEncoder against reference DS021t telegrams, and its
+ * throughput against building the whole telegram in a string as
+ * IbisProtocol::setDS021t did before.
+ */
+
+/**
+ * @brief MemoryTransport that also records the largest single write
+ */
+class BlockTransport : public MemoryTransport<8192> {
+public:
+  size_t write(ByteSpan bytes) {
+    if (bytes.size > largest) largest = bytes.size;
+    return MemoryTransport<8192>::write(bytes);
+  }
+
+  size_t largest = 0;
+};
+
+static BlockTransport out;
+static IbisDs021tEncoder<BlockTransport> encoder(out,
+                                                 IBIS_CODEPAGE_DIN66003);
+
+void setUp() {
+  out.clear();
+  out.largest = 0;
+}
+void tearDown() {}
+
+static void assertFrame(const uint8_t *expected, size_t len) {
+  TEST_ASSERT_EQUAL(len, out.length());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out.data(), len);
+  TEST_ASSERT_EQUAL(1, out.frames());
+}
+
+// --- Reference telegrams ---
+
+// One block: "Hello" \n\n and 9 spaces of padding
+static void test_single_block() {
+  const uint8_t expected[] = {
+      'a',  'A',  '1',  '1',  'A',  '0',  'H',  'e',
+      'l',  'l',  'o',  0x0A, 0x0A, ' ',  ' ',  ' ',
+      ' ',  ' ',  ' ',  ' ',  ' ',  ' ',  0x0D, 0x41};
+  TEST_ASSERT_EQUAL(sizeof(expected), encoder.encode("1", "Hello"));
+  assertFrame(expected, sizeof(expected));
+}
+
+// A line break adds a blank line; 13 + 3 characters fill one block exactly
+static void test_line_break() {
+  const uint8_t expected[] = {
+      'a',  'A',  '1',  '1',  'A',  '0',  'L',  'i',
+      'n',  'e',  ' ',  '1',  0x0A, 'L',  'i',  'n',
+      'e',  ' ',  '2',  0x0A, 0x0A, 0x0A, 0x0D, 0x20};
+  TEST_ASSERT_EQUAL(sizeof(expected),
+                    encoder.encode("1", "Line 1\nLine 2"));
+  assertFrame(expected, sizeof(expected));
+}
+
+// Umlauts are transcoded to DIN 66003 before the blocks are counted
+static void test_transcoded() {
+  const uint8_t expected[] = {
+      'a', 'A', '1', '2', '1', 'A', '0', 'R',  '}',  'd',  'e', 's', 'h',
+      'e', 'i', 'm', ' ', 'H', 'b', 'f', 0x0A, 0x0A, ' ', 0x0D, 0x09};
+  TEST_ASSERT_EQUAL(sizeof(expected),
+                    encoder.encode("12", "R\xC3\xBC" "desheim Hbf"));
+  assertFrame(expected, sizeof(expected));
+}
+
+// The block count in the header matches the padded text for any length,
+// and the telegram reaches the transport at most one block at a time
+static void test_block_count() {
+  std::string text;
+  for (size_t len = 0; len < 300; len++) {
+    out.clear();
+    out.largest = 0;
+    size_t bytes = encoder.encode("1", text.c_str());
+    size_t blocks = (len + 2 + 15) / 16;
+    size_t digits = blocks >> 4 ? 2 : 1;
+    // "aA1", the count, "A0", the blocks, CR and parity
+    TEST_ASSERT_EQUAL(3 + digits + 2 + blocks * 16 + 2, bytes);
+
+    const uint8_t *count = out.data() + 3;
+    size_t header = digits == 2 ? (count[0] - '0') * 16 + count[1] - '0'
+                                : count[0] - '0';
+    TEST_ASSERT_EQUAL(blocks, header);
+    TEST_ASSERT_LESS_OR_EQUAL(IBIS_DS021T_BLOCK, out.largest);
+
+    uint8_t parity = IBIS_PARITY_SEED;
+    for (size_t i = 0; i < bytes - 2; i++) parity ^= out.data()[i];
+    TEST_ASSERT_EQUAL_HEX8(0x0D, out.data()[bytes - 2]);
+    TEST_ASSERT_EQUAL_HEX8(parity, out.data()[bytes - 1]);
+    text += 'A' + len % 26;
+  }
+}
+
+// 255 blocks ("??") is the most the header can hold, 256 is refused
+static void test_block_limit() {
+  std::string text(IBIS_DS021T_MAX_BLOCKS * IBIS_DS021T_BLOCK - 2, 'x');
+  size_t bytes = encoder.encode("1", text.c_str());
+  TEST_ASSERT_EQUAL(6 + 1 + IBIS_DS021T_MAX_BLOCKS * IBIS_DS021T_BLOCK + 2,
+                    bytes);
+  TEST_ASSERT_EQUAL('?', out.data()[3]);
+  TEST_ASSERT_EQUAL('?', out.data()[4]);
+
+  out.clear();
+  text += 'x';
+  TEST_ASSERT_EQUAL(0, encoder.encode("1", text.c_str()));
+  TEST_ASSERT_EQUAL(0, out.length());
+}
+
+// --- Throughput ---
+
+// The old setDS021t: whole telegram in one growing string, padded one
+// space at a time. Its block count is fixed so both give the same bytes.
+static void stringDs021t(BlockTransport &transport,
+                         const std::string &address,
+                         std::string text) {
+  static const char VDV_HEX[] = "0123456789:;<=>?";
+  if (text.find('\n') != std::string::npos && text[0] != '\n') text += "\n";
+  text += "\n\n";
+  size_t blocks = (text.length() + 15) / 16;
+  std::string telegram = "aA" + address;
+  if (blocks >> 4) telegram += VDV_HEX[blocks >> 4];
+  telegram += VDV_HEX[blocks & 0x0F];
+  telegram += "A0";
+  telegram += text;
+  for (size_t i = text.length(); i % 16; i++) telegram += " ";
+
+  uint8_t parity = IBIS_PARITY_SEED;
+  for (char c : telegram) parity ^= (uint8_t)c;
+  const uint8_t end[] = {0x0D, parity};
+  transport.write(
+      ByteSpan{(const uint8_t *)telegram.data(), telegram.size()});
+  transport.write(ByteSpan{end, sizeof(end)});
+  transport.flush();
+}
+
+static void bench_throughput() {
+  for (size_t len : {14, 100, 500}) {
+    std::string text;
+    for (size_t i = 0; i < len; i++) {
+      text += i % 20 == 19 ? ' ' : 'a' + i % 26;
+    }
+
+    out.clear();
+    stringDs021t(out, "1", text);
+    std::string reference((const char *)out.data(), out.length());
+    out.clear();
+    encoder.encode("1", text.c_str());
+    TEST_ASSERT_EQUAL(reference.size(), out.length());
+    TEST_ASSERT_EQUAL_MEMORY(reference.data(), out.data(), out.length());
+
+    double string = benchMicros(20000, [&] {
+      out.clear();
+      stringDs021t(out, "1", text);
+    });
+    double stream = benchMicros(20000, [&] {
+      out.clear();
+      encoder.encode("1", text.c_str());
+    });
+    char name[48];
+    snprintf(name, sizeof(name), "DS021t, %zu characters", len);
+    benchCompare(name, string, stream);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_single_block);
+  RUN_TEST(test_line_break);
+  RUN_TEST(test_transcoded);
+  RUN_TEST(test_block_count);
+  RUN_TEST(test_block_limit);
+  RUN_TEST(bench_throughput);
+  return UNITY_END();
+}
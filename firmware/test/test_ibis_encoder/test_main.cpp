@@ -0,0 +1,176 @@
+#include <stdlib.h>
+#include <unity.h>
+#include <new>
+#include <string>
+#include "../bench.h"
+#include "ibis_encoder.h"
+
+/*
+ * Heap allocations per telegram of IbisEncoder against the String
+ * encoder IbisProtocol used before, with std::string standing in for
+ * Arduino's String. Both must put the same bytes on the bus.
+ *
+ * Like Arduino's String, std::string keeps short strings inline, so only
+ * the text telegrams allocate on the String side. For those IbisEncoder
+ * also transcodes the UTF-8 text, which the String encoder did not.
+ */
+
+// Every operator new in this program is counted
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  void *ptr = malloc(size ? size : 1);
+  if (!ptr) throw std::bad_alloc();
+  return ptr;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *ptr) noexcept { free(ptr); }
+void operator delete[](void *ptr) noexcept { free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { free(ptr); }
+
+typedef MemoryTransport<256> Transport;
+
+/**
+ * @brief The telegram builders of the old IbisProtocol, by value and
+ * concatenation as they were
+ */
+class StringEncoder {
+public:
+  explicit StringEncoder(Transport &transport) : _transport(transport) {}
+
+  void line(uint16_t line) { send("l" + padNumber(line, 3)); }
+  void destination(uint16_t dest) { send("z" + padNumber(dest, 3)); }
+  void cycle(uint8_t cycle) { send("xC" + std::to_string(cycle)); }
+  void time(std::string hhmm) { send("u" + hhmm); }
+  void text(std::string text) { send("v" + text); }
+  void complexText(std::string text) { send("zM " + text); }
+  void symbol(std::string number) { send("lE0" + number); }
+
+private:
+  Transport &_transport;
+
+  void send(std::string telegram) {
+    uint8_t parity = IBIS_PARITY_SEED;
+    for (char c : telegram) parity ^= (uint8_t)c;
+    const uint8_t end[] = {0x0D, parity};
+    _transport.write(
+        ByteSpan{(const uint8_t *)telegram.data(), telegram.size()});
+    _transport.write(ByteSpan{end, sizeof(end)});
+    _transport.flush();
+  }
+
+  static std::string padNumber(uint16_t num, uint8_t digits) {
+    std::string s = std::to_string(num);
+    while (s.length() < digits) s = "0" + s;
+    return s;
+  }
+};
+
+#define TEXT "Hlavni nadrazi - Namesti Miru - Sidliste Jih"
+
+// One telegram of each kind, sent through either encoder
+struct Telegram {
+  const char *name;
+  void (*string)(StringEncoder &encoder);
+  void (*fixed)(IbisEncoder<Transport> &encoder);
+};
+
+static const Telegram TELEGRAMS[] = {
+    {"line", [](StringEncoder &e) { e.line(12); },
+     [](IbisEncoder<Transport> &e) { e.line(12); }},
+    {"destination", [](StringEncoder &e) { e.destination(345); },
+     [](IbisEncoder<Transport> &e) { e.destination(345); }},
+    {"cycle", [](StringEncoder &e) { e.cycle(3); },
+     [](IbisEncoder<Transport> &e) { e.cycle(3); }},
+    {"time", [](StringEncoder &e) { e.time("0745"); },
+     [](IbisEncoder<Transport> &e) { e.time("0745"); }},
+    {"text", [](StringEncoder &e) { e.text(TEXT); },
+     [](IbisEncoder<Transport> &e) { e.text(TEXT); }},
+    {"complexText", [](StringEncoder &e) { e.complexText(TEXT); },
+     [](IbisEncoder<Transport> &e) { e.complexText(TEXT); }},
+    {"symbol", [](StringEncoder &e) { e.symbol("12"); },
+     [](IbisEncoder<Transport> &e) { e.symbol("12"); }},
+};
+
+static Transport stringOut, fixedOut;
+static StringEncoder stringEncoder(stringOut);
+static IbisEncoder<Transport> fixedEncoder(fixedOut);
+
+void setUp() {
+  stringOut.clear();
+  fixedOut.clear();
+}
+void tearDown() {}
+
+static void test_same_bytes() {
+  for (const Telegram &telegram : TELEGRAMS) {
+    stringOut.clear();
+    fixedOut.clear();
+    telegram.string(stringEncoder);
+    telegram.fixed(fixedEncoder);
+    TEST_ASSERT_EQUAL_MESSAGE(stringOut.length(), fixedOut.length(),
+                              telegram.name);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(stringOut.data(), fixedOut.data(),
+                                 fixedOut.length());
+  }
+}
+
+// "l012" CR, parity 0x72 ^ 'l' ^ '0' ^ '1' ^ '2' = 0x2D
+static void test_line_frame() {
+  fixedEncoder.line(12);
+  const uint8_t expected[] = {'l', '0', '1', '2', 0x0D, 0x2D};
+  TEST_ASSERT_EQUAL(sizeof(expected), fixedOut.length());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, fixedOut.data(), sizeof(expected));
+}
+
+static void bench_allocations() {
+  const size_t runs = 1000;
+  for (const Telegram &telegram : TELEGRAMS) {
+    size_t before = allocations;
+    for (size_t i = 0; i < runs; i++) {
+      stringOut.clear();
+      telegram.string(stringEncoder);
+    }
+    size_t stringAllocs = allocations - before;
+
+    before = allocations;
+    for (size_t i = 0; i < runs; i++) {
+      fixedOut.clear();
+      telegram.fixed(fixedEncoder);
+    }
+    size_t fixedAllocs = allocations - before;
+
+    printf("bench: %-12s allocations per telegram: String %.1f, "
+           "IbisEncoder %.1f\n",
+           telegram.name, (double)stringAllocs / runs,
+           (double)fixedAllocs / runs);
+    TEST_ASSERT_EQUAL_MESSAGE(0, fixedAllocs, telegram.name);
+  }
+}
+
+static void bench_time() {
+  for (const Telegram &telegram : TELEGRAMS) {
+    double string = benchMicros(20000, [&] {
+      stringOut.clear();
+      telegram.string(stringEncoder);
+    });
+    double fixed = benchMicros(20000, [&] {
+      fixedOut.clear();
+      telegram.fixed(fixedEncoder);
+    });
+    char name[48];
+    snprintf(name, sizeof(name), "%s telegram", telegram.name);
+    benchCompare(name, string, fixed);
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_same_bytes);
+  RUN_TEST(test_line_frame);
+  RUN_TEST(bench_allocations);
+  RUN_TEST(bench_time);
+  return UNITY_END();
+}
@@ -0,0 +1,172 @@
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <sstream>
+#include <string>
+#include "../bench.h"
+
+/*
+ * The two ways FileManager has parsed /index.json, on generated catalogs
+ * of 100, 1,000 and 10,000 routes shaped like the desktop exporter's:
+ *
+ *   buffered  the whole file read into a string, then parsed
+ *   streamed  parsed from the file stream through the field filter
+ *             (FileManager::readJsonIndex)
+ *
+ * Peak heap is what the parse holds at most: for the buffered path the
+ * file copy plus the document, for the streamed path the document only.
+ */
+
+// Counts the heap ArduinoJson holds, like JsonStatsAllocator on the device
+class CountingAllocator : public ArduinoJson::Allocator {
+public:
+  size_t current = 0;
+  size_t peak = 0;
+
+  void *allocate(size_t size) override {
+    Header *header = (Header *)malloc(sizeof(Header) + size);
+    if (!header) return nullptr;
+    header->size = size;
+    grow(size);
+    return header + 1;
+  }
+
+  void deallocate(void *ptr) override {
+    if (!ptr) return;
+    Header *header = (Header *)ptr - 1;
+    current -= header->size;
+    free(header);
+  }
+
+  void *reallocate(void *ptr, size_t size) override {
+    if (!ptr) return allocate(size);
+    Header *header = (Header *)ptr - 1;
+    size_t before = header->size;
+    header = (Header *)realloc(header, sizeof(Header) + size);
+    if (!header) return nullptr;
+    header->size = size;
+    current -= before;
+    grow(size);
+    return header + 1;
+  }
+
+private:
+  union Header {
+    size_t size;
+    max_align_t align;
+  };
+
+  void grow(size_t size) {
+    current += size;
+    if (current > peak) peak = current;
+  }
+};
+
+struct ParseResult {
+  size_t routes;
+  size_t peak;
+  std::string lastName;
+};
+
+void setUp() {}
+void tearDown() {}
+
+// Same layout as JSON.stringify(indexData, null, 2) in the exporter
+static std::string makeCatalog(size_t routes) {
+  std::string json = "{\n  \"buses\": [";
+  for (size_t i = 0; i < routes; i++) {
+    if (i == routes / 2) json += "\n  ],\n  \"trams\": [";
+    bool first = i == 0 || i == routes / 2;
+    char entry[256];
+    snprintf(entry, sizeof(entry),
+             "%s\n    {\n"
+             "      \"name\": \"%zu Hlavni nadrazi - Sidliste Jih\",\n"
+             "      \"file\": \"route-%06zu\",\n"
+             "      \"ibisLineCmd\": %zu,\n"
+             "      \"ibisDestinationCmd\": %zu\n"
+             "    }",
+             first ? "" : ",", i % 999 + 1, i, i % 999 + 1, i % 1000);
+    json += entry;
+  }
+  json += "\n  ]\n}";
+  return json;
+}
+
+static ParseResult readBuffered(const std::string &file) {
+  CountingAllocator stats;
+  ParseResult result = {};
+  {
+    std::string content = file;  // File::readString()
+    JsonDocument doc(&stats);
+    if (deserializeJson(doc, content)) return result;
+    result.routes = doc["buses"].size() + doc["trams"].size();
+    result.lastName =
+        doc["trams"][doc["trams"].size() - 1]["name"].as<std::string>();
+    result.peak = stats.peak + content.capacity();
+  }
+  return result;
+}
+
+static ParseResult readStreamed(const std::string &file) {
+  JsonDocument filter;
+  for (const char *list : {"buses", "trams"}) {
+    filter[list][0]["name"] = true;
+    filter[list][0]["file"] = true;
+    filter[list][0]["ibisLineCmd"] = true;
+    filter[list][0]["ibisDestinationCmd"] = true;
+  }
+
+  CountingAllocator stats;
+  ParseResult result = {};
+  std::istringstream stream(file);  // the LittleFS File
+  JsonDocument doc(&stats);
+  if (deserializeJson(doc, stream, DeserializationOption::Filter(filter))) {
+    return result;
+  }
+  result.routes = doc["buses"].size() + doc["trams"].size();
+  result.lastName =
+      doc["trams"][doc["trams"].size() - 1]["name"].as<std::string>();
+  result.peak = stats.peak;
+  return result;
+}
+
+static void compare(size_t routes, size_t runs) {
+  std::string file = makeCatalog(routes);
+
+  ParseResult buffered = readBuffered(file);
+  ParseResult streamed = readStreamed(file);
+  TEST_ASSERT_EQUAL(routes, buffered.routes);
+  TEST_ASSERT_EQUAL(routes, streamed.routes);
+  TEST_ASSERT_EQUAL_STRING(buffered.lastName.c_str(),
+                           streamed.lastName.c_str());
+  // The file copy is gone
+  TEST_ASSERT_LESS_THAN(buffered.peak, streamed.peak);
+
+  double bufferedUs = benchMicros(runs, [&] {
+    benchSink = benchSink + readBuffered(file).routes;
+  });
+  double streamedUs = benchMicros(runs, [&] {
+    benchSink = benchSink + readStreamed(file).routes;
+  });
+  printf("bench: | %6zu | %9zu | %8.2f | %9zu | %8.2f | %9zu |\n", routes,
+         file.size(), bufferedUs / 1000, buffered.peak, streamedUs / 1000,
+         streamed.peak);
+}
+
+static void bench_index_100() { compare(100, 200); }
+static void bench_index_1000() { compare(1000, 20); }
+static void bench_index_10000() { compare(10000, 3); }
+
+int main() {
+  UNITY_BEGIN();
+  // One row per catalog, ready to paste into a commit message
+  printf("bench: | routes |  file (B) | buffered | peak (B)  | streamed |"
+         " peak (B)  |\n"
+         "bench: |        |           |   (ms)   |           |   (ms)   |"
+         "           |\n");
+  RUN_TEST(bench_index_100);
+  RUN_TEST(bench_index_1000);
+  RUN_TEST(bench_index_10000);
+  return UNITY_END();
+}
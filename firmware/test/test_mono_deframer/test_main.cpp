@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+#include "mono_deframer.h"
+
+/*
+ * MonoDeframer on what MonoEncoder sends and on broken input as it comes
+ * off the bus: bad checksums, an escape right before the delimiter, frames
+ * longer than a raw frame and noise between frames.
+ */
+
+typedef MemoryTransport<MONO_FRAME_MAX * 4> Transport;
+
+static Transport out;
+static MonoEncoder<Transport> encoder(out);
+static MonoDeframer deframer;
+
+void setUp() {
+  srand(1);
+  out.clear();
+  deframer.reset();
+}
+void tearDown() {}
+
+struct Fed {
+  std::vector<MonoDeframer::Result> results;
+  std::vector<std::vector<uint8_t>> frames;
+};
+
+// Feeds every byte and keeps everything that is not NONE
+static Fed feed(const uint8_t *bytes, size_t len) {
+  Fed fed;
+  for (size_t i = 0; i < len; i++) {
+    MonoDeframer::Result result = deframer.feed(bytes[i]);
+    if (result == MonoDeframer::NONE) continue;
+    fed.results.push_back(result);
+    if (result == MonoDeframer::FRAME) {
+      fed.frames.emplace_back(deframer.frame(),
+                              deframer.frame() + deframer.length());
+    }
+  }
+  return fed;
+}
+
+static Fed feed(const std::vector<uint8_t> &bytes) {
+  return feed(bytes.data(), bytes.size());
+}
+
+// Command byte, payload and checksum as they were before escaping
+static std::vector<uint8_t> rawFrame(uint8_t command,
+                                     const uint8_t *payload,
+                                     size_t len,
+                                     MonoChecksum checksum) {
+  std::vector<uint8_t> raw(1, command);
+  raw.insert(raw.end(), payload, payload + len);
+  if (checksum == MONO_CHECKSUM_LED) {
+    raw.push_back(monoChecksumLed(raw.data(), raw.size()));
+  } else {
+    raw.push_back(monoChecksumFlipdot(raw.data(), raw.size()));
+  }
+  return raw;
+}
+
+// --- Encoder round trip ---
+
+static void roundTrip(MonoChecksum checksum) {
+  uint8_t payload[MONO_RAW_MAX - 2];
+  for (size_t len = 0; len <= sizeof(payload); len++) {
+    out.clear();
+    // Plenty of delimiters and escapes in the payload and checksum
+    for (size_t i = 0; i < len; i++) {
+      payload[i] = rand() & 1 ? 0x7C + rand() % 3 : rand();
+    }
+    size_t bytes = encoder.command(MONO_CMD_BITMAP_DATA_LED, 3, payload, len,
+                                   checksum);
+    TEST_ASSERT_NOT_EQUAL(0, bytes);
+
+    Fed fed = feed(out.data(), out.length());
+    TEST_ASSERT_EQUAL(1, fed.results.size());
+    TEST_ASSERT_EQUAL(MonoDeframer::FRAME, fed.results[0]);
+    std::vector<uint8_t> raw =
+        rawFrame(MONO_CMD_BITMAP_DATA_LED | 3, payload, len, checksum);
+    TEST_ASSERT_EQUAL(raw.size(), fed.frames[0].size());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(raw.data(), fed.frames[0].data(), raw.size());
+  }
+}
+
+static void test_round_trip_flipdot() { roundTrip(MONO_CHECKSUM_FLIPDOT); }
+static void test_round_trip_led() { roundTrip(MONO_CHECKSUM_LED); }
+
+// Frames may share the delimiter between them or each bring their own
+static void test_back_to_back() {
+  const uint8_t payload[] = {0x7E, 0x00, 0x7D};
+  encoder.query(1);
+  encoder.command(MONO_CMD_COLUMN_DATA_FLIPDOT, 2, payload, sizeof(payload));
+  std::vector<uint8_t> own(out.data(), out.data() + out.length());
+  TEST_ASSERT_EQUAL(2, feed(own).frames.size());
+
+  // Drop the opening delimiter of the second frame
+  std::vector<uint8_t> shared;
+  for (size_t i = 0; i < own.size(); i++) {
+    if (i > 0 && own[i] == MONO_FRAME_DELIMITER &&
+        own[i - 1] == MONO_FRAME_DELIMITER) {
+      continue;
+    }
+    shared.push_back(own[i]);
+  }
+  TEST_ASSERT_EQUAL(own.size() - 1, shared.size());
+  Fed fed = feed(shared);
+  TEST_ASSERT_EQUAL(2, fed.frames.size());
+  TEST_ASSERT_EQUAL_HEX8(MONO_CMD_QUERY | 1, fed.frames[0][0]);
+  TEST_ASSERT_EQUAL_HEX8(MONO_CMD_COLUMN_DATA_FLIPDOT | 2, fed.frames[1][0]);
+}
+
+// --- Broken input ---
+
+static void test_bad_checksum() {
+  // 0x81 and a flipdot checksum of 0x7E would be valid, 0x7F is not
+  const uint8_t bytes[] = {0x7E, 0x81, 0x7F, 0x7E};
+  Fed fed = feed(bytes, sizeof(bytes));
+  TEST_ASSERT_EQUAL(1, fed.results.size());
+  TEST_ASSERT_EQUAL(MonoDeframer::BAD_FRAME, fed.results[0]);
+}
+
+static void test_too_short() {
+  const uint8_t bytes[] = {0x7E, 0xFF, 0x7E};
+  Fed fed = feed(bytes, sizeof(bytes));
+  TEST_ASSERT_EQUAL(1, fed.results.size());
+  TEST_ASSERT_EQUAL(MonoDeframer::BAD_FRAME, fed.results[0]);
+}
+
+// An escape cut off by the delimiter breaks the frame, not the next one
+static void test_escape_at_end() {
+  std::vector<uint8_t> bytes = {0x7E, 0x81, 0x7D, 0x7E};
+  encoder.query(1);
+  bytes.insert(bytes.end(), out.data(), out.data() + out.length());
+  Fed fed = feed(bytes);
+  TEST_ASSERT_EQUAL(2, fed.results.size());
+  TEST_ASSERT_EQUAL(MonoDeframer::BAD_FRAME, fed.results[0]);
+  TEST_ASSERT_EQUAL(MonoDeframer::FRAME, fed.results[1]);
+  TEST_ASSERT_EQUAL(2, fed.frames[0].size());
+  TEST_ASSERT_EQUAL_HEX8(MONO_CMD_QUERY | 1, fed.frames[0][0]);
+}
+
+// The longest raw frame fits, one byte more is dropped as a whole
+static void test_overrun() {
+  uint8_t payload[MONO_RAW_MAX - 2] = {};
+  encoder.command(MONO_CMD_BITMAP_DATA_LED, 1, payload, sizeof(payload));
+  Fed fed = feed(out.data(), out.length());
+  TEST_ASSERT_EQUAL(1, fed.frames.size());
+  TEST_ASSERT_EQUAL(MONO_RAW_MAX, fed.frames[0].size());
+
+  std::vector<uint8_t> bytes(MONO_RAW_MAX + 3, 0x00);
+  bytes.front() = MONO_FRAME_DELIMITER;
+  bytes.back() = MONO_FRAME_DELIMITER;
+  out.clear();
+  encoder.query(4);
+  bytes.insert(bytes.end(), out.data(), out.data() + out.length());
+  fed = feed(bytes);
+  TEST_ASSERT_EQUAL(2, fed.results.size());
+  TEST_ASSERT_EQUAL(MonoDeframer::BAD_FRAME, fed.results[0]);
+  TEST_ASSERT_EQUAL(MonoDeframer::FRAME, fed.results[1]);
+  TEST_ASSERT_EQUAL_HEX8(MONO_CMD_QUERY | 4, fed.frames[0][0]);
+}
+
+// Line noise before a frame is reported once, then the frame comes through
+static void test_resync_after_noise() {
+  std::vector<uint8_t> bytes = {0x12, 0x7D, 0x34};
+  encoder.query(9);
+  bytes.insert(bytes.end(), out.data(), out.data() + out.length());
+  Fed fed = feed(bytes);
+  TEST_ASSERT_EQUAL(2, fed.results.size());
+  TEST_ASSERT_EQUAL(MonoDeframer::BAD_FRAME, fed.results[0]);
+  TEST_ASSERT_EQUAL(1, fed.frames.size());
+  TEST_ASSERT_EQUAL_HEX8(MONO_CMD_QUERY | 9, fed.frames[0][0]);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_flipdot);
+  RUN_TEST(test_round_trip_led);
+  RUN_TEST(test_back_to_back);
+  RUN_TEST(test_bad_checksum);
+  RUN_TEST(test_too_short);
+  RUN_TEST(test_escape_at_end);
+  RUN_TEST(test_overrun);
+  RUN_TEST(test_resync_after_noise);
+  return UNITY_END();
+}
@@ -0,0 +1,251 @@
+#include <stdlib.h>
+#include <unity.h>
+#include "../bench.h"
+#include "mono_encoder.h"
+#include "mono_pack.h"
+
+/*
+ * The word-wide kernels in mono_pack.h against per-pixel reference
+ * implementations, byte for byte, and the time both take for a 112x16
+ * flipdot sign.
+ */
+
+#define MAX_WIDTH 120
+#define MAX_HEIGHT 64
+
+static uint8_t pixels[MonoBitmap::bytesFor(MAX_WIDTH, MAX_HEIGHT)];
+static uint8_t shownPixels[MonoBitmap::bytesFor(MAX_WIDTH, MAX_HEIGHT)];
+
+void setUp() { srand(1); }
+void tearDown() {}
+
+static void fillRandom(MonoBitmap &bitmap) {
+  for (uint16_t x = 0; x < bitmap.width; x++) {
+    for (uint16_t y = 0; y < bitmap.height; y++) {
+      bitmap.set(x, y, rand() & 1);
+    }
+  }
+}
+
+// --- Per-pixel references ---
+
+static void refTranspose8(const uint8_t in[8], uint8_t out[8]) {
+  for (int c = 0; c < 8; c++) {
+    out[c] = 0;
+    for (int r = 0; r < 8; r++) {
+      if (in[r] & (0x80 >> c)) out[c] |= 0x80 >> r;
+    }
+  }
+}
+
+static void refFromRows(const uint8_t *rows, size_t stride, MonoBitmap &dst) {
+  dst.clear();
+  for (uint16_t y = 0; y < dst.height; y++) {
+    for (uint16_t x = 0; x < dst.width; x++) {
+      dst.set(x, y, rows[y * stride + x / 8] & (0x80 >> (x % 8)));
+    }
+  }
+}
+
+static size_t refPackColumn(const MonoBitmap &bitmap,
+                            uint16_t x,
+                            uint8_t *out) {
+  size_t bytes = (bitmap.height + 3) / 4;
+  for (size_t i = 0; i < bytes; i++) {
+    uint8_t byte = 0xAA;
+    for (uint8_t bit = 0; bit < 4; bit++) {
+      int y = (int)((bytes - 1 - i) * 4 + bit);
+      if (bitmap.get(x, bitmap.height - y - 1)) byte |= 1 << (6 - bit * 2);
+    }
+    out[i] = byte;
+  }
+  return bytes;
+}
+
+static size_t refPackColumnDiff(const MonoBitmap &bitmap,
+                                const MonoBitmap &shown,
+                                uint16_t x,
+                                uint8_t *out) {
+  size_t bytes = (bitmap.height + 3) / 4;
+  size_t changed = 0;
+  for (size_t i = 0; i < bytes; i++) {
+    uint8_t byte = 0x00;
+    for (uint8_t bit = 0; bit < 4; bit++) {
+      int y = bitmap.height - (int)((bytes - 1 - i) * 4 + bit) - 1;
+      bool on = bitmap.get(x, y);
+      if (y < 0 || on == shown.get(x, y)) continue;
+      byte |= (on ? 0x3 : 0x2) << (6 - bit * 2);
+      changed++;
+    }
+    out[i] = byte;
+  }
+  return changed;
+}
+
+// --- Byte-exact tests ---
+
+static void test_transpose8() {
+  for (int run = 0; run < 1000; run++) {
+    uint8_t in[8], expected[8];
+    for (int r = 0; r < 8; r++) in[r] = rand();
+    refTranspose8(in, expected);
+
+    uint32_t hi = (uint32_t)in[0] << 24 | in[1] << 16 | in[2] << 8 | in[3];
+    uint32_t lo = (uint32_t)in[4] << 24 | in[5] << 16 | in[6] << 8 | in[7];
+    monoTranspose8(hi, lo);
+    uint8_t out[8] = {(uint8_t)(hi >> 24), (uint8_t)(hi >> 16),
+                      (uint8_t)(hi >> 8),  (uint8_t)hi,
+                      (uint8_t)(lo >> 24), (uint8_t)(lo >> 16),
+                      (uint8_t)(lo >> 8),  (uint8_t)lo};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, 8);
+  }
+}
+
+static void test_from_rows() {
+  static uint8_t rows[MAX_HEIGHT * (MAX_WIDTH / 8 + 1)];
+  static uint8_t expectedPixels[sizeof(pixels)];
+  for (uint16_t height = 1; height <= 40; height++) {
+    for (uint16_t width = 1; width <= 70; width += 3) {
+      size_t stride = (width + 7) / 8;
+      for (size_t i = 0; i < height * stride; i++) rows[i] = rand();
+
+      MonoBitmap expected(width, height, expectedPixels);
+      refFromRows(rows, stride, expected);
+      MonoBitmap bitmap(width, height, pixels);
+      bitmap.clear();
+      monoFromRows(rows, stride, bitmap);
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(expectedPixels, pixels, bitmap.bytes());
+    }
+  }
+}
+
+static void test_column_from_bottom() {
+  for (uint16_t height = 1; height <= MAX_HEIGHT; height++) {
+    MonoBitmap bitmap(8, height, pixels);
+    fillRandom(bitmap);
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      uint64_t expected = 0;
+      for (uint16_t i = 0; i < height; i++) {
+        if (bitmap.get(x, height - 1 - i)) expected |= 1ULL << i;
+      }
+      TEST_ASSERT_EQUAL_UINT64(expected, monoColumnFromBottom(bitmap, x));
+    }
+  }
+}
+
+static void test_pack_column() {
+  uint8_t expected[MAX_HEIGHT / 4], out[MAX_HEIGHT / 4];
+  for (uint16_t height = 1; height <= MAX_HEIGHT; height++) {
+    MonoBitmap bitmap(16, height, pixels);
+    fillRandom(bitmap);
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      size_t len = refPackColumn(bitmap, x, expected);
+      TEST_ASSERT_EQUAL(len,
+                        MonoEncoder<BufferTransport>::packFlipdotColumn(
+                            bitmap, x, out));
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, len);
+    }
+  }
+}
+
+static void test_pack_column_diff() {
+  uint8_t expected[MAX_HEIGHT / 4], out[MAX_HEIGHT / 4];
+  for (uint16_t height = 1; height <= MAX_HEIGHT; height++) {
+    MonoBitmap bitmap(16, height, pixels);
+    MonoBitmap shown(16, height, shownPixels);
+    fillRandom(bitmap);
+    fillRandom(shown);
+    // Some columns unchanged, to cover the zero case
+    memcpy(shownPixels, pixels, 4 * bitmap.stride());
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      size_t changed = refPackColumnDiff(bitmap, shown, x, expected);
+      TEST_ASSERT_EQUAL(changed,
+                        MonoEncoder<BufferTransport>::packFlipdotColumnDiff(
+                            bitmap, shown, x, out));
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, (height + 3) / 4);
+    }
+  }
+}
+
+// One dot at the top of a 1x4 sign: column 0, data 0xAB, checksum 0xF5
+static void test_flipdot_column_frame() {
+  uint8_t data[1] = {0x01};
+  MonoBitmap bitmap(1, 4, data);
+  MemoryTransport<64> transport;
+  MonoEncoder<MemoryTransport<64>> encoder(transport);
+  uint8_t column[1];
+  size_t len = encoder.packFlipdotColumn(bitmap, 0, column);
+  encoder.flipdotColumn(1, 0, column, len);
+
+  const uint8_t expected[] = {0x7E, 0xA1, 0x00, 0xAB, 0x00, 0xF5, 0x7E};
+  TEST_ASSERT_EQUAL(sizeof(expected), transport.length());
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, transport.data(), sizeof(expected));
+  TEST_ASSERT_EQUAL(1, transport.frames());
+}
+
+// --- Benchmarks, 112x16 flipdot sign ---
+
+static void bench_pack_112x16() {
+  MonoBitmap bitmap(112, 16, pixels);
+  MonoBitmap shown(112, 16, shownPixels);
+  fillRandom(bitmap);
+  fillRandom(shown);
+  uint8_t out[4];
+
+  double ref = benchMicros(2000, [&] {
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      refPackColumn(bitmap, x, out);
+      benchSink = benchSink + out[0];
+    }
+  });
+  double fast = benchMicros(2000, [&] {
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      MonoEncoder<BufferTransport>::packFlipdotColumn(bitmap, x, out);
+      benchSink = benchSink + out[0];
+    }
+  });
+  benchCompare("packFlipdotColumn, 112 columns", ref, fast);
+
+  ref = benchMicros(2000, [&] {
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      benchSink = benchSink + refPackColumnDiff(bitmap, shown, x, out);
+    }
+  });
+  fast = benchMicros(2000, [&] {
+    for (uint16_t x = 0; x < bitmap.width; x++) {
+      benchSink = benchSink +
+                  MonoEncoder<BufferTransport>::packFlipdotColumnDiff(
+                      bitmap, shown, x, out);
+    }
+  });
+  benchCompare("packFlipdotColumnDiff, 112 columns", ref, fast);
+}
+
+static void bench_from_rows_112x16() {
+  static uint8_t rows[16 * 14];
+  for (size_t i = 0; i < sizeof(rows); i++) rows[i] = rand();
+  MonoBitmap bitmap(112, 16, pixels);
+
+  double ref = benchMicros(2000, [&] {
+    refFromRows(rows, 14, bitmap);
+    benchSink = benchSink + pixels[0];
+  });
+  double fast = benchMicros(2000, [&] {
+    monoFromRows(rows, 14, bitmap);
+    benchSink = benchSink + pixels[0];
+  });
+  benchCompare("monoFromRows, 112x16", ref, fast);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_transpose8);
+  RUN_TEST(test_from_rows);
+  RUN_TEST(test_column_from_bottom);
+  RUN_TEST(test_pack_column);
+  RUN_TEST(test_pack_column_diff);
+  RUN_TEST(test_flipdot_column_frame);
+  RUN_TEST(bench_pack_112x16);
+  RUN_TEST(bench_from_rows_112x16);
+  return UNITY_END();
+}
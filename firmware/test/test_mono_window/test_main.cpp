@@ -0,0 +1,199 @@
+#include <stdlib.h>
+#include <unity.h>
+#include <algorithm>
+#include <initializer_list>
+#include "../bench.h"
+#include "mono_window.h"
+
+/*
+ * The bit-shifting copies in mono_window.cpp against per-pixel reference
+ * implementations: panel slices at any row of the canvas
+ * (SignLayout::slice), marquee windows wrapping around the strip
+ * (SignMarquee::frame) and LAWO glyph rows and columns (LawoFont).
+ */
+
+#define MAX_WIDTH 64
+#define MAX_HEIGHT 40
+
+static uint8_t srcPixels[MonoBitmap::bytesFor(MAX_WIDTH, MAX_HEIGHT)];
+static uint8_t pixels[MonoBitmap::bytesFor(MAX_WIDTH, MAX_HEIGHT)];
+static uint8_t expectedPixels[MonoBitmap::bytesFor(MAX_WIDTH, MAX_HEIGHT)];
+
+void setUp() { srand(1); }
+void tearDown() {}
+
+// Random dots; rows past the height stay clear as everywhere in the tree
+static void fillRandom(MonoBitmap &bitmap) {
+  bitmap.clear();
+  for (uint16_t x = 0; x < bitmap.width; x++) {
+    for (uint16_t y = 0; y < bitmap.height; y++) {
+      bitmap.set(x, y, rand() & 1);
+    }
+  }
+}
+
+// Garbage, padding bits included, so every output bit must be written
+static void fillGarbage(uint8_t *data, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) data[i] = rand();
+}
+
+// --- Per-pixel references ---
+
+static void refCopyWindow(const MonoBitmap &src,
+                          uint16_t x,
+                          uint16_t y,
+                          MonoBitmap &dst) {
+  dst.clear();
+  for (uint16_t i = 0; i < dst.width; i++) {
+    for (uint16_t j = 0; j < dst.height; j++) {
+      dst.set(i, j, src.get(x + i, y + j));
+    }
+  }
+}
+
+static void refCopyColumnsWrapped(const MonoBitmap &src,
+                                  uint32_t offset,
+                                  uint32_t cycle,
+                                  MonoBitmap &dst) {
+  dst.clear();
+  for (uint16_t x = 0; x < dst.width; x++) {
+    uint32_t column = cycle ? (offset + x) % cycle : x;
+    for (uint16_t y = 0; y < dst.height; y++) {
+      dst.set(x, y, column < src.width && src.get(column, y));
+    }
+  }
+}
+
+static uint32_t refRowBits(const uint8_t *row, uint32_t bit, uint8_t count) {
+  uint32_t bits = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    uint32_t b = bit + i;
+    if (row[b / 8] & (0x80 >> (b % 8))) bits |= 0x80000000UL >> i;
+  }
+  return bits;
+}
+
+static void refOrColumn(MonoBitmap &dst, int x, int y, uint32_t bits) {
+  for (int i = 0; i < 32; i++) {
+    if (bits & (1UL << i)) dst.set(x, y + i, true);
+  }
+}
+
+// --- Byte-exact tests ---
+
+// Every window position of every panel size that fits the canvas, so
+// panel.y covers all eight bit offsets and the canvas' last byte
+static void test_copy_window() {
+  MonoBitmap src(20, MAX_HEIGHT, srcPixels);
+  fillRandom(src);
+  for (uint16_t height = 1; height <= MAX_HEIGHT; height++) {
+    for (uint16_t y = 0; y + height <= src.height; y++) {
+      for (uint16_t x = 0; x < 20; x += 7) {
+        uint16_t width = std::min(6, 20 - x);
+        MonoBitmap expected(width, height, expectedPixels);
+        refCopyWindow(src, x, y, expected);
+        MonoBitmap dst(width, height, pixels);
+        fillGarbage(pixels, dst.bytes());
+        monoCopyWindow(src, x, y, dst);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expectedPixels, pixels, dst.bytes());
+      }
+    }
+  }
+}
+
+// Scrolling with a gap and paging, across several rounds of the cycle
+static void test_copy_columns_wrapped() {
+  for (uint16_t height : {7, 16, 19}) {
+    MonoBitmap src(50, height, srcPixels);
+    fillRandom(src);
+    for (uint32_t cycle : {0u, 50u, 50u + 32u, 53u}) {
+      for (uint32_t offset = 0; offset < 160; offset += 3) {
+        MonoBitmap expected(28, height, expectedPixels);
+        refCopyColumnsWrapped(src, offset, cycle, expected);
+        MonoBitmap dst(28, height, pixels);
+        fillGarbage(pixels, dst.bytes());
+        monoCopyColumnsWrapped(src, offset, cycle, dst);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expectedPixels, pixels, dst.bytes());
+      }
+    }
+  }
+}
+
+// A canvas wider than the strip shows it once, then blank columns
+static void test_copy_columns_no_cycle() {
+  MonoBitmap src(10, 16, srcPixels);
+  fillRandom(src);
+  MonoBitmap expected(30, 16, expectedPixels);
+  refCopyColumnsWrapped(src, 0, 0, expected);
+  MonoBitmap dst(30, 16, pixels);
+  fillGarbage(pixels, dst.bytes());
+  monoCopyColumnsWrapped(src, 0, 0, dst);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expectedPixels, pixels, dst.bytes());
+}
+
+// The row ends right after the last pixel asked for, so an overread of
+// the row shows up under ASan
+static void test_row_bits() {
+  uint8_t row[12];
+  for (int run = 0; run < 20; run++) {
+    fillGarbage(row, sizeof(row));
+    for (uint32_t bit = 0; bit < 64; bit++) {
+      for (uint8_t count = 1; count <= 32; count++) {
+        if (bit + count > sizeof(row) * 8) continue;
+        TEST_ASSERT_EQUAL_HEX32(refRowBits(row, bit, count),
+                                monoRowBits(row, bit, count));
+      }
+    }
+  }
+}
+
+// Glyph columns at every vertical position, including above and below the
+// bitmap, and off its left and right edges
+static void test_or_column() {
+  for (uint16_t height : {5, 8, 16, 19, 40}) {
+    for (int y = -34; y <= height + 2; y++) {
+      for (int x : {-1, 0, 3, 4}) {
+        uint32_t bits = ((uint32_t)rand() << 16 ^ rand()) | 1 | 1UL << 31;
+        MonoBitmap expected(4, height, expectedPixels);
+        fillRandom(expected);
+        MonoBitmap dst(4, height, pixels);
+        memcpy(pixels, expectedPixels, expected.bytes());
+
+        refOrColumn(expected, x, y, bits);
+        monoOrColumn(dst, x, y, bits);
+        TEST_ASSERT_EQUAL_HEX8_ARRAY(expectedPixels, pixels, dst.bytes());
+      }
+    }
+  }
+}
+
+// --- Benchmark, 112x16 panel slice at an unaligned row ---
+
+static void bench_copy_window() {
+  static uint8_t canvasPixels[MonoBitmap::bytesFor(112, 24)];
+  static uint8_t panelPixels[MonoBitmap::bytesFor(112, 16)];
+  MonoBitmap canvas(112, 24, canvasPixels);
+  fillRandom(canvas);
+  MonoBitmap panel(112, 16, panelPixels);
+
+  double ref = benchMicros(2000, [&] {
+    refCopyWindow(canvas, 0, 5, panel);
+    benchSink = benchSink + panelPixels[0];
+  });
+  double fast = benchMicros(2000, [&] {
+    monoCopyWindow(canvas, 0, 5, panel);
+    benchSink = benchSink + panelPixels[0];
+  });
+  benchCompare("monoCopyWindow, 112x16 at y = 5", ref, fast);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_copy_window);
+  RUN_TEST(test_copy_columns_wrapped);
+  RUN_TEST(test_copy_columns_no_cycle);
+  RUN_TEST(test_row_bits);
+  RUN_TEST(test_or_column);
+  RUN_TEST(bench_copy_window);
+  return UNITY_END();
+}
@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <unity.h>
+#include <vector>
+#include "sign_asset.h"
+
+/*
+ * The .sbm reader on files as the exporter writes them and on files that
+ * are truncated or lie about their sizes: the entry table and every
+ * image must stay inside the file, and PackBits data must fill the
+ * bitmap exactly.
+ */
+
+typedef std::vector<uint8_t> Bytes;
+
+void setUp() { srand(1); }
+void tearDown() {}
+
+// PackBits as the exporter writes it: runs of 3 or more, literals up to 128
+static Bytes packBitsEncode(const Bytes &in) {
+  Bytes out;
+  size_t i = 0;
+  while (i < in.size()) {
+    size_t run = 1;
+    while (i + run < in.size() && run < 128 && in[i + run] == in[i]) run++;
+    if (run >= 3) {
+      out.push_back((uint8_t)(257 - run));
+      out.push_back(in[i]);
+      i += run;
+      continue;
+    }
+    size_t start = i;
+    while (i < in.size() && i - start < 128) {
+      if (i + 2 < in.size() && in[i] == in[i + 1] && in[i] == in[i + 2]) break;
+      i++;
+    }
+    out.push_back((uint8_t)(i - start - 1));
+    out.insert(out.end(), in.begin() + start, in.begin() + i);
+  }
+  return out;
+}
+
+struct Image {
+  uint16_t width;
+  uint16_t height;
+  Bytes packed;
+};
+
+static void putLe(Bytes &out, uint32_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) out.push_back(value >> (8 * i));
+}
+
+static Bytes makeAsset(const std::vector<Image> &images) {
+  Bytes file;
+  putLe(file, SIGN_ASSET_MAGIC, 4);
+  file.push_back(SIGN_ASSET_VERSION);
+  file.push_back(images.size());
+  putLe(file, 0, 2);
+  uint32_t offset = sizeof(SignAssetHeader) +
+                    images.size() * sizeof(SignAssetEntry);
+  for (const Image &image : images) {
+    putLe(file, image.width, 2);
+    putLe(file, image.height, 2);
+    putLe(file, offset, 4);
+    putLe(file, image.packed.size(), 4);
+    offset += image.packed.size();
+  }
+  for (const Image &image : images) {
+    file.insert(file.end(), image.packed.begin(), image.packed.end());
+  }
+  return file;
+}
+
+// Rows of a width x height bitmap with long runs, as sign content has
+static Bytes makeRows(uint16_t width, uint16_t height) {
+  Bytes rows((width + 7) / 8 * height);
+  for (size_t i = 0; i < rows.size(); i++) {
+    rows[i] = rand() % 4 ? 0x00 : rand();
+  }
+  return rows;
+}
+
+// Overwrites a field of the n-th entry
+static void patchEntry(Bytes &file, size_t n, size_t field, uint32_t value) {
+  size_t at = sizeof(SignAssetHeader) + n * sizeof(SignAssetEntry) + field;
+  for (size_t i = 0; i < 4; i++) file[at + i] = value >> (8 * i);
+}
+
+#define ENTRY_OFFSET 4
+#define ENTRY_LENGTH 8
+
+// --- signAssetFind ---
+
+static void test_find() {
+  Bytes a(10, 0x11), b(20, 0x22), c(30, 0x33);
+  Bytes file = makeAsset({{112, 16, a}, {84, 16, b}, {300, 16, c}});
+  SignAssetEntry entry;
+
+  TEST_ASSERT_TRUE(signAssetFind(file.data(), file.size(), 84, 16, entry));
+  TEST_ASSERT_EQUAL(84, entry.width);
+  TEST_ASSERT_EQUAL(20, entry.length);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(b.data(), file.data() + entry.offset, 20);
+
+  // The first image wider than the sign is its strip
+  TEST_ASSERT_TRUE(
+      signAssetFind(file.data(), file.size(), 112, 16, entry, true));
+  TEST_ASSERT_EQUAL(300, entry.width);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(c.data(), file.data() + entry.offset, 30);
+
+  TEST_ASSERT_FALSE(signAssetFind(file.data(), file.size(), 112, 8, entry));
+  TEST_ASSERT_FALSE(
+      signAssetFind(file.data(), file.size(), 300, 16, entry, true));
+}
+
+static void test_find_bad_header() {
+  Bytes file = makeAsset({{112, 16, Bytes(4, 0)}});
+  SignAssetEntry entry;
+  for (size_t len = 0; len < sizeof(SignAssetHeader); len++) {
+    TEST_ASSERT_FALSE(signAssetFind(file.data(), len, 112, 16, entry));
+  }
+
+  Bytes magic = file;
+  magic[0] ^= 1;
+  TEST_ASSERT_FALSE(signAssetFind(magic.data(), magic.size(), 112, 16, entry));
+
+  Bytes version = file;
+  version[4] = SIGN_ASSET_VERSION + 1;
+  TEST_ASSERT_FALSE(
+      signAssetFind(version.data(), version.size(), 112, 16, entry));
+}
+
+// The entry table must fit in the file, even for entries after the match
+static void test_find_truncated_table() {
+  Bytes file = makeAsset({{112, 16, Bytes()}, {84, 16, Bytes()}});
+  SignAssetEntry entry;
+  size_t table = sizeof(SignAssetHeader) + 2 * sizeof(SignAssetEntry);
+  TEST_ASSERT_EQUAL(table, file.size());
+  TEST_ASSERT_TRUE(signAssetFind(file.data(), table, 112, 16, entry));
+  for (size_t len = sizeof(SignAssetHeader); len < table; len++) {
+    TEST_ASSERT_FALSE(signAssetFind(file.data(), len, 112, 16, entry));
+  }
+
+  // A count of 255 entries on an 8 byte file
+  Bytes header(file.begin(), file.begin() + sizeof(SignAssetHeader));
+  header[5] = 255;
+  TEST_ASSERT_FALSE(
+      signAssetFind(header.data(), header.size(), 112, 16, entry));
+}
+
+// Images that reach past the end of the file, also through a wrap of
+// offset + length, are refused
+static void test_find_image_outside() {
+  Bytes file = makeAsset({{112, 16, Bytes(16, 0xAA)}});
+  SignAssetEntry entry;
+  uint32_t offset = sizeof(SignAssetHeader) + sizeof(SignAssetEntry);
+
+  Bytes bad = file;
+  patchEntry(bad, 0, ENTRY_LENGTH, 17);
+  TEST_ASSERT_FALSE(signAssetFind(bad.data(), bad.size(), 112, 16, entry));
+
+  bad = file;
+  patchEntry(bad, 0, ENTRY_OFFSET, file.size() + 1);
+  patchEntry(bad, 0, ENTRY_LENGTH, 0);
+  TEST_ASSERT_FALSE(signAssetFind(bad.data(), bad.size(), 112, 16, entry));
+
+  bad = file;
+  patchEntry(bad, 0, ENTRY_LENGTH, 0xFFFFFFFF - offset + 1);
+  TEST_ASSERT_FALSE(signAssetFind(bad.data(), bad.size(), 112, 16, entry));
+
+  bad = file;
+  patchEntry(bad, 0, ENTRY_OFFSET, 0xFFFFFFF0);
+  patchEntry(bad, 0, ENTRY_LENGTH, 0x20);
+  TEST_ASSERT_FALSE(signAssetFind(bad.data(), bad.size(), 112, 16, entry));
+
+  // Ending exactly at the end of the file is fine
+  TEST_ASSERT_TRUE(signAssetFind(file.data(), file.size(), 112, 16, entry));
+  TEST_ASSERT_EQUAL(file.size(), entry.offset + entry.length);
+}
+
+// --- packBitsDecode ---
+
+static void test_decode_reference() {
+  // Literal of 3, run of 4, no-op, literal of 1
+  const uint8_t packed[] = {0x02, 0x01, 0x02, 0x03, 0xFD, 0xAA,
+                            0x80, 0x00, 0x7E};
+  const uint8_t expected[] = {0x01, 0x02, 0x03, 0xAA, 0xAA,
+                              0xAA, 0xAA, 0x7E};
+  uint8_t out[sizeof(expected)];
+  TEST_ASSERT_TRUE(packBitsDecode(packed, sizeof(packed), out, sizeof(out)));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, out, sizeof(expected));
+
+  TEST_ASSERT_TRUE(packBitsDecode(packed, 0, out, 0));
+}
+
+static void test_decode_round_trip() {
+  for (uint16_t height = 1; height <= 32; height += 5) {
+    for (uint16_t width = 1; width <= 400; width += 37) {
+      Bytes rows = makeRows(width, height);
+      Bytes packed = packBitsEncode(rows);
+      Bytes out(rows.size());
+      TEST_ASSERT_TRUE(
+          packBitsDecode(packed.data(), packed.size(), out.data(), out.size()));
+      TEST_ASSERT_EQUAL_HEX8_ARRAY(rows.data(), out.data(), rows.size());
+    }
+  }
+}
+
+// Cut anywhere, the data no longer fills the bitmap
+static void test_decode_truncated() {
+  Bytes rows = makeRows(112, 16);
+  Bytes packed = packBitsEncode(rows);
+  Bytes out(rows.size());
+  for (size_t len = 0; len < packed.size(); len++) {
+    TEST_ASSERT_FALSE(
+        packBitsDecode(packed.data(), len, out.data(), out.size()));
+  }
+
+  // A literal or run header with its data missing
+  const uint8_t literal[] = {0x03, 0x01, 0x02};
+  TEST_ASSERT_FALSE(packBitsDecode(literal, sizeof(literal), out.data(), 4));
+  const uint8_t run[] = {0xFD};
+  TEST_ASSERT_FALSE(packBitsDecode(run, sizeof(run), out.data(), 4));
+}
+
+// More data than the bitmap holds is refused without writing past it
+static void test_decode_oversized() {
+  uint8_t out[8 + 1];
+  out[8] = 0x5A;
+
+  const uint8_t run[] = {0xF7, 0xFF};  // 9 bytes
+  TEST_ASSERT_FALSE(packBitsDecode(run, sizeof(run), out, 8));
+  const uint8_t literal[] = {0x08, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  TEST_ASSERT_FALSE(packBitsDecode(literal, sizeof(literal), out, 8));
+  const uint8_t extra[] = {0xF9, 0x00, 0x00, 0x01};  // 8 bytes, then one
+  TEST_ASSERT_FALSE(packBitsDecode(extra, sizeof(extra), out, 8));
+  TEST_ASSERT_EQUAL_HEX8(0x5A, out[8]);
+
+  Bytes rows = makeRows(112, 16);
+  Bytes packed = packBitsEncode(rows);
+  Bytes small(rows.size() - 1);
+  TEST_ASSERT_FALSE(packBitsDecode(packed.data(), packed.size(), small.data(),
+                                   small.size()));
+}
+
+// --- Whole asset ---
+
+static void test_asset_round_trip() {
+  Bytes narrow = makeRows(84, 16), wide = makeRows(112, 19);
+  Bytes file = makeAsset({{84, 16, packBitsEncode(narrow)},
+                          {112, 19, packBitsEncode(wide)}});
+  SignAssetEntry entry;
+  TEST_ASSERT_TRUE(signAssetFind(file.data(), file.size(), 112, 19, entry));
+  Bytes out(wide.size());
+  TEST_ASSERT_TRUE(packBitsDecode(file.data() + entry.offset, entry.length,
+                                  out.data(), out.size()));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(wide.data(), out.data(), wide.size());
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_find);
+  RUN_TEST(test_find_bad_header);
+  RUN_TEST(test_find_truncated_table);
+  RUN_TEST(test_find_image_outside);
+  RUN_TEST(test_decode_reference);
+  RUN_TEST(test_decode_round_trip);
+  RUN_TEST(test_decode_truncated);
+  RUN_TEST(test_decode_oversized);
+  RUN_TEST(test_asset_round_trip);
+  return UNITY_END();
+}
@@ -0,0 +1,157 @@
+#include <unity.h>
+#include "../bench.h"
+#include "ibis_encoder.h"
+#include "mono_encoder.h"
+
+/*
+ * The encoders on host transports: MemoryTransport behaviour, and the
+ * cost of the compile-time transport against the same encoders calling
+ * through a virtual interface, as a HardwareSerial& did.
+ */
+
+static_assert(IsSignTransport<MemoryTransport<16>>::value,
+              "MemoryTransport is a transport");
+static_assert(IsSignTransport<BufferTransport>::value,
+              "BufferTransport is a transport");
+
+struct NoClock {
+  size_t write(ByteSpan bytes) { return bytes.size; }
+  void flush() {}
+};
+static_assert(!IsSignTransport<NoClock>::value, "now() is required");
+
+/**
+ * @brief A transport behind virtual calls, the way the encoders wrote to
+ * a Stream before they took the transport as a template parameter
+ */
+class VirtualSink {
+public:
+  virtual ~VirtualSink() = default;
+  virtual size_t write(ByteSpan bytes) = 0;
+  virtual void flush() = 0;
+  virtual uint32_t now() = 0;
+};
+
+template <size_t Capacity>
+class VirtualMemory : public VirtualSink {
+public:
+  size_t write(ByteSpan bytes) override { return _memory.write(bytes); }
+  void flush() override { _memory.flush(); }
+  uint32_t now() override { return _memory.now(); }
+
+  MemoryTransport<Capacity> &memory() { return _memory; }
+
+private:
+  MemoryTransport<Capacity> _memory;
+};
+
+// Forwards to a VirtualSink&; each call is an indirect call
+class VirtualTransport {
+public:
+  explicit VirtualTransport(VirtualSink &sink) : _sink(sink) {}
+  size_t write(ByteSpan bytes) { return _sink.write(bytes); }
+  void flush() { _sink.flush(); }
+  uint32_t now() { return _sink.now(); }
+
+private:
+  VirtualSink &_sink;
+};
+
+#define ROUTE_TEXT "Hlavni nadrazi - Namesti Miru"
+
+// Everything IbisProtocol sends for a route change
+template <typename Transport>
+static size_t sendRoute(IbisEncoder<Transport> &encoder) {
+  return encoder.line(12) + encoder.destination(345) +
+         encoder.text(ROUTE_TEXT) + encoder.complexText(ROUTE_TEXT) +
+         encoder.ds021t("1", ROUTE_TEXT "\n" ROUTE_TEXT);
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void test_memory_transport() {
+  MemoryTransport<8> transport;
+  const uint8_t bytes[] = {1, 2, 3, 4, 5, 6};
+  TEST_ASSERT_EQUAL(6, transport.write(ByteSpan{bytes, 6}));
+  transport.flush();
+  TEST_ASSERT_EQUAL(2, transport.write(ByteSpan{bytes, 6}));
+  TEST_ASSERT_TRUE(transport.overflowed());
+  TEST_ASSERT_EQUAL(8, transport.length());
+  TEST_ASSERT_EQUAL(1, transport.frames());
+
+  TEST_ASSERT_EQUAL(0, transport.now());
+  transport.advance(25);
+  TEST_ASSERT_EQUAL(25, transport.now());
+
+  transport.clear();
+  TEST_ASSERT_EQUAL(0, transport.length());
+  TEST_ASSERT_FALSE(transport.overflowed());
+}
+
+// Both transports see the same frames
+static void test_same_frames() {
+  MemoryTransport<1024> direct;
+  IbisEncoder<MemoryTransport<1024>> encoder(direct);
+  VirtualMemory<1024> sink;
+  VirtualTransport indirect(sink);
+  IbisEncoder<VirtualTransport> virtualEncoder(indirect);
+
+  TEST_ASSERT_EQUAL(sendRoute(encoder), sendRoute(virtualEncoder));
+  TEST_ASSERT_EQUAL(5, direct.frames());
+  TEST_ASSERT_EQUAL(direct.length(), sink.memory().length());
+  TEST_ASSERT_EQUAL_MEMORY(direct.data(), sink.memory().data(),
+                           direct.length());
+}
+
+static void bench_ibis_route() {
+  MemoryTransport<1024> direct;
+  IbisEncoder<MemoryTransport<1024>> encoder(direct);
+  VirtualMemory<1024> sink;
+  VirtualTransport indirect(sink);
+  IbisEncoder<VirtualTransport> virtualEncoder(indirect);
+
+  double virtualUs = benchMicros(20000, [&] {
+    sink.memory().clear();
+    benchSink = benchSink + sendRoute(virtualEncoder);
+  });
+  double directUs = benchMicros(20000, [&] {
+    direct.clear();
+    benchSink = benchSink + sendRoute(encoder);
+  });
+  benchCompare("IBIS route change, virtual -> template", virtualUs,
+               directUs);
+}
+
+static void bench_mono_flipdot() {
+  static uint8_t pixels[MonoBitmap::bytesFor(112, 16)];
+  for (size_t i = 0; i < sizeof(pixels); i++) pixels[i] = i * 37;
+  MonoBitmap bitmap(112, 16, pixels);
+
+  static MemoryTransport<4096> direct;
+  MonoEncoder<MemoryTransport<4096>> encoder(direct);
+  static VirtualMemory<4096> sink;
+  VirtualTransport indirect(sink);
+  MonoEncoder<VirtualTransport> virtualEncoder(indirect);
+
+  double virtualUs = benchMicros(5000, [&] {
+    sink.memory().clear();
+    benchSink = benchSink + virtualEncoder.flipdotImage(1, bitmap);
+  });
+  double directUs = benchMicros(5000, [&] {
+    direct.clear();
+    benchSink = benchSink + encoder.flipdotImage(1, bitmap);
+  });
+  TEST_ASSERT_EQUAL(direct.length(), sink.memory().length());
+  benchCompare("MONO 112x16 flipdot, virtual -> template", virtualUs,
+               directUs);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_memory_transport);
+  RUN_TEST(test_same_frames);
+  RUN_TEST(bench_ibis_route);
+  RUN_TEST(bench_mono_flipdot);
+  return UNITY_END();
+}